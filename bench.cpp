@@ -0,0 +1,145 @@
+/* bench.cpp
+
+Copyright 2023 Roger D. Voss
+
+Created by github user roger-dv on 04/08/2023.
+
+Licensed under the MIT License - refer to LICENSE project document.
+
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <ranges>
+#include <string>
+#include <vector>
+#include "bench_corpus.h"
+#include "collection_append.h"
+#include "count_occurrences.h"
+#include "print_collection.h"
+#include "ranking.h"
+#include "tokenizer.h"
+
+// Benchmark of the stages of the word frequency pipeline over synthetic corpora:
+//   tokenize - word_view over a memory mapped corpus file (the rng0 of main())
+//   count    - count_occurrences() of the words
+//   append   - flipping the count table into the vector of count pairs
+//   rank     - rank_count_pairs()
+//   print    - print_collection() (to /dev/null)
+// Each stage is timed on its own, the best of several repetitions.
+//
+// usage: wrd-frq-rngs-bench [corpus-MiB] [repetitions]
+
+namespace {
+
+template<typename F>
+double best_ms(int reps, F &&run) {
+  double best = 1e300;
+  for(int i = 0; i < reps; i++) {
+    const auto start = std::chrono::steady_clock::now();
+    run();
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  return best;
+}
+
+void report(const char *stage, double ms, std::size_t items, const char *per) {
+  printf("  %-9s %10.2f ms %10.2f ns/%s\n", stage, ms, ms * 1e6 / static_cast<double>(std::max<std::size_t>(items, 1)), per);
+}
+
+void bench_corpus(const char *name, const std::string &text, int reps) {
+  // the corpus is written to an (unlinked) temporary file so that it's read just as stdin would be
+  FILE *const tmp = std::tmpfile();
+  if (tmp == nullptr) {
+    perror("tmpfile");
+    std::exit(EXIT_FAILURE);
+  }
+  const int fd = fileno(tmp);
+  {
+    output_sink out{fd};
+    out << text;
+    out.flush();
+  }
+
+  // all words of the corpus are gathered once, for the count stage to be timed on its own
+  std::string all_words{};
+  std::vector<std::size_t> word_ends{};
+  {
+    ::lseek(fd, 0, SEEK_SET); // (an input_source reads from the current offset of its file descriptor)
+    input_source source{fd};
+    for(const auto word : word_view{source}) {
+      all_words += word;
+      word_ends.push_back(all_words.size());
+    }
+  }
+  std::vector<std::string_view> words{};
+  words.reserve(word_ends.size());
+  std::size_t start = 0;
+  for(const auto end : word_ends) {
+    words.emplace_back(all_words.data() + start, end - start);
+    start = end;
+  }
+
+  printf("%s: %.1f MiB, %zu words\n", name, static_cast<double>(text.size()) / (1024 * 1024), words.size());
+
+  std::size_t n_words = 0;
+  const auto tokenize_ms = best_ms(reps, [&] {
+    ::lseek(fd, 0, SEEK_SET);
+    input_source source{fd};
+    n_words = static_cast<std::size_t>(std::ranges::distance(word_view{source}));
+  });
+  report("tokenize", tokenize_ms, n_words, "word");
+  printf("  %-9s %10.2f MiB/s\n", "", static_cast<double>(text.size()) / (1024 * 1024) / (tokenize_ms / 1000));
+
+  // counted as an unsized range, the same as the streamed rng0 of main()
+  auto const all = [](std::string_view) { return true; };
+  std::pmr::monotonic_buffer_resource word_storage{1024 * 1024};
+  const auto count_ms = best_ms(reps, [&] {
+    word_storage.release();
+    (void) count_occurrences(words | std::views::filter(all), &word_storage);
+  });
+  const auto counts_map = count_occurrences(words | std::views::filter(all));
+  report("count", count_ms, words.size(), "word");
+
+  std::vector<count_pair_t> count_pairs{};
+  auto const flip_pair = [](const auto &entry) { return count_pair_t{entry.second, std::string_view{entry.first}}; };
+  const auto append_ms = best_ms(reps, [&] {
+    count_pairs.clear();
+    count_pairs.reserve(counts_map.size());
+    collection_append add_count_pairs{count_pairs};
+    add_count_pairs.append_range(counts_map | std::views::transform(flip_pair));
+  });
+  report("append", append_ms, counts_map.size(), "entry");
+
+  std::vector<count_pair_t> ranked{};
+  double rank_ms = 1e300;
+  for(int i = 0; i < reps; i++) {
+    ranked = count_pairs;
+    rank_ms = std::min(rank_ms, best_ms(1, [&] { rank_count_pairs(ranked); }));
+  }
+  report("rank", rank_ms, ranked.size(), "entry");
+
+  const int dev_null = ::open("/dev/null", O_WRONLY);
+  const auto print_ms = best_ms(reps, [&] { print_collection(ranked, dev_null); });
+  ::close(dev_null);
+  report("print", print_ms, ranked.size(), "entry");
+
+  std::fclose(tmp);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const std::size_t mib = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 32;
+  const int reps = argc > 2 ? std::atoi(argv[2]) : 3;
+  const auto bytes = mib * 1024 * 1024;
+
+  bench_corpus("zipf", make_zipf_corpus(bytes), reps);
+  bench_corpus("zipf-large-vocabulary", make_zipf_corpus(bytes, 2'000'000), reps);
+  bench_corpus("log", make_log_corpus(bytes), reps);
+  bench_corpus("long-tokens", make_long_token_corpus(bytes), reps);
+}
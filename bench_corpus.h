@@ -0,0 +1,157 @@
+/* bench_corpus.h
+
+Copyright 2023 Roger D. Voss
+
+Created by github user roger-dv on 04/08/2023.
+
+Licensed under the MIT License - refer to LICENSE project document.
+
+*/
+#ifndef BENCH_CORPUS_H
+#define BENCH_CORPUS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+// Deterministic synthetic corpora for the benchmarks - the same seed
+// always generates the same text, so runs are reproducible.
+
+/**
+ * Generates a vocabulary of random lowercase words (short words
+ * may repeat, so the distinct count can be a little less).
+ *
+ * @param rng random number generator
+ * @param n_vocab number of words
+ * @param min_length minimum length of a word
+ * @param max_length maximum length of a word
+ * @return the words of the vocabulary
+ */
+inline std::vector<std::string> make_vocabulary(std::mt19937_64 &rng, std::size_t n_vocab,
+                                                std::size_t min_length = 2, std::size_t max_length = 12) {
+  std::uniform_int_distribution<int> letter{'a', 'z'};
+  std::uniform_int_distribution<std::size_t> length{min_length, max_length};
+  std::vector<std::string> vocab(n_vocab);
+  for(auto &word : vocab) {
+    word.resize(length(rng));
+    std::ranges::generate(word, [&] { return static_cast<char>(letter(rng)); });
+  }
+  return vocab;
+}
+
+/**
+ * A distribution of vocabulary indices following Zipf's law - the
+ * frequency of the word of rank i is proportional to 1 / i^s.
+ */
+class zipf_distribution {
+private:
+  std::discrete_distribution<std::size_t> ranks{};
+public:
+  explicit zipf_distribution(std::size_t n_vocab, double s = 1.0) {
+    std::vector<double> weights(n_vocab);
+    for(std::size_t i = 0; i < n_vocab; i++) { weights[i] = 1.0 / std::pow(static_cast<double>(i + 1), s); }
+    ranks = std::discrete_distribution<std::size_t>{weights.begin(), weights.end()};
+  }
+  std::size_t operator()(std::mt19937_64 &rng) { return ranks(rng); }
+};
+
+/**
+ * Prose like text - Zipf distributed words from a vocabulary, one
+ * in ten capitalized, a dozen or so words to a line.
+ *
+ * @param bytes approximate size of the corpus
+ * @param n_vocab size of the vocabulary
+ * @param seed random seed
+ * @return the corpus text
+ */
+inline std::string make_zipf_corpus(std::size_t bytes, std::size_t n_vocab = 100'000, std::uint64_t seed = 42) {
+  std::mt19937_64 rng{seed};
+  const auto vocab = make_vocabulary(rng, n_vocab);
+  zipf_distribution zipf{n_vocab};
+  std::uniform_int_distribution<int> percent{0, 99};
+  std::string text{};
+  text.reserve(bytes + 64);
+  while (text.size() < bytes) {
+    const auto &word = vocab[zipf(rng)];
+    const auto start = text.size();
+    text += word;
+    if (percent(rng) < 10) { text[start] = static_cast<char>(text[start] - ('a' - 'A')); }
+    text += percent(rng) < 8 ? '\n' : ' ';
+  }
+  return text;
+}
+
+/**
+ * Log file like text - timestamped lines of mostly non-word tokens
+ * (numbers, key=value pairs, paths) around a few message words.
+ *
+ * @param bytes approximate size of the corpus
+ * @param seed random seed
+ * @return the corpus text
+ */
+inline std::string make_log_corpus(std::size_t bytes, std::uint64_t seed = 42) {
+  static const char *const levels[] = {"INFO", "INFO", "INFO", "DEBUG", "WARN", "ERROR"};
+  static const char *const paths[] = {"/api/v1/users", "/api/v1/orders", "/healthz", "/static/app.js"};
+  std::mt19937_64 rng{seed};
+  const auto vocab = make_vocabulary(rng, 2'000, 3, 10);
+  zipf_distribution zipf{vocab.size()};
+  std::uniform_int_distribution<unsigned> number{0, 99'999};
+  std::string text{};
+  text.reserve(bytes + 256);
+  std::uint64_t millis = 1'680'000'000'000;
+  while (text.size() < bytes) {
+    millis += number(rng) % 50;
+    text += std::to_string(millis);
+    text += ' ';
+    text += levels[number(rng) % std::size(levels)];
+    text += " [worker-";
+    text += std::to_string(number(rng) % 64);
+    text += "] ";
+    for(auto n = 2 + number(rng) % 6; n > 0; n--) {
+      text += vocab[zipf(rng)];
+      text += ' ';
+    }
+    text += "GET ";
+    text += paths[number(rng) % std::size(paths)];
+    text += '/';
+    text += std::to_string(number(rng));
+    text += " status=";
+    text += std::to_string(200 + number(rng) % 4 * 100);
+    text += " latency_ms=";
+    text += std::to_string(number(rng) % 1'000);
+    text += '\n';
+  }
+  return text;
+}
+
+/**
+ * Text of very long tokens (4 KiB to 1 MiB of letters), interspersed
+ * with short words, to stress tokens that cross input chunks.
+ *
+ * @param bytes approximate size of the corpus
+ * @param seed random seed
+ * @return the corpus text
+ */
+inline std::string make_long_token_corpus(std::size_t bytes, std::uint64_t seed = 42) {
+  std::mt19937_64 rng{seed};
+  std::uniform_int_distribution<std::size_t> length{4 * 1024, 1024 * 1024};
+  std::uniform_int_distribution<int> letter{'a', 'z'};
+  const auto vocab = make_vocabulary(rng, 1'000);
+  std::string text{};
+  text.reserve(bytes + 2 * 1024 * 1024);
+  while (text.size() < bytes) {
+    text.append(length(rng), static_cast<char>(letter(rng)));
+    text += ' ';
+    for(int i = 0; i < 100; i++) {
+      text += vocab[rng() % vocab.size()];
+      text += ' ';
+    }
+    text += '\n';
+  }
+  return text;
+}
+
+#endif //BENCH_CORPUS_H
@@ -0,0 +1,90 @@
+/* collection_append.h
+
+Copyright 2023 Roger D. Voss
+
+Created by github user roger-dv on 04/08/2023.
+
+Licensed under the MIT License - refer to LICENSE project document.
+
+*/
+#ifndef COLLECTION_APPEND_H
+#define COLLECTION_APPEND_H
+
+#include <algorithm>
+#include <concepts>
+#include <iterator>
+#include <ranges>
+#include <utility>
+
+template<typename C, typename E = typename C::value_type>
+concept AppendableCollection = requires(C c) {
+  { &c } -> std::input_iterator;
+  requires std::move_constructible<E>;
+  { c.emplace_back(std::move(E{})) };
+};
+
+template<typename R, typename T>
+concept MovableRangeElement = requires(R r) {
+  std::ranges::begin(r);
+  std::ranges::end(r);
+  { *(r.begin()) } -> std::same_as<T>;
+  requires std::move_constructible<T>;
+};
+
+/**
+ * This template class is just an exercise in writing
+ * a class that has some behaviors of a collection and
+ * how to use concepts to constrain aspects of that.
+ *
+ * An instantiation of this template will wrap the
+ * actual underlying collection.
+ *
+ * IOW, in the word counting code below, this class
+ * could be dispensed with and the underlying collection
+ * used directly instead. Again, is for learning.
+ *
+ * @tparam C type of the collection being wrapped
+ * @tparam T type of a collection element
+ * @tparam CIter constant iterator type
+ * @tparam Iter non constant iterator type
+ */
+template <typename C,
+          typename T = typename C::value_type,
+          typename CIter = typename C::const_iterator,
+          typename Iter = typename C::iterator>
+  requires AppendableCollection<C>
+class collection_append {
+private: C &collection;
+public:
+  using value_type [[maybe_unused]] = T;
+  using const_iterator [[maybe_unused]] = CIter;
+  using iterator = Iter;
+  explicit collection_append(C &coll) : collection(coll) {}
+  collection_append() = delete;
+  collection_append(const collection_append&) = delete;
+  collection_append(collection_append&&) = delete;
+  ~collection_append() = default;
+  collection_append&operator =(const collection_append&) = delete;
+  collection_append&operator =(collection_append&&) = delete;
+
+  collection_append& append(T &&item) {
+    this->collection.emplace_back(item);
+    return *this;
+  }
+
+  template<typename R>
+    requires MovableRangeElement<R, T>
+  void append_range(R &&rng) {
+    std::ranges::for_each(rng, [this](auto &&e){ collection.emplace_back(e); });
+  }
+
+  inline iterator begin() noexcept {
+    return this->collection.begin();
+  }
+
+  inline iterator end() noexcept {
+    return this->collection.end();
+  }
+};
+
+#endif //COLLECTION_APPEND_H
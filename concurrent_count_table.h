@@ -0,0 +1,315 @@
+/* concurrent_count_table.h
+
+Copyright 2023 Roger D. Voss
+
+Created by github user roger-dv on 04/08/2023.
+
+Licensed under the MIT License - refer to LICENSE project document.
+
+*/
+#ifndef CONCURRENT_COUNT_TABLE_H
+#define CONCURRENT_COUNT_TABLE_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "count_occurrences.h"
+
+/**
+ * A word count table that many threads can count into at once,
+ * without locks - an insert-or-increment open addressing (linear
+ * probing) table where a new word claims its slot with a CAS and
+ * a count is bumped with an atomic fetch_add.
+ *
+ * A slot is claimed by a CAS of its meta word (the hash fingerprint
+ * and length of the word) from zero; the claiming thread then copies
+ * the word into its own key arena and publishes the key pointer. A
+ * thread that finds a matching meta word waits (briefly) for the key
+ * to be published before comparing the word bytes.
+ *
+ * Rather than stopping the world to rehash, the table grows by adding
+ * levels - each level twice the capacity of the one before. A word is
+ * looked up level by level and a new word is inserted into the first
+ * level that is below its load limit. As a word in a later level is
+ * only found after probing every level before it, the first level is
+ * best presized for the expected vocabulary so that there's only the
+ * one level. (A race at the moment a level fills can leave a word in
+ * two levels - consolidate() folds such a word into the earlier level
+ * once the counting is done.)
+ *
+ * Each thread counts through a writer obtained from make_writer(),
+ * which holds the key arena of that thread. The key arenas belong to
+ * the table, so the words outlive the counting threads.
+ *
+ * Once consolidated, the table is read as any other count table is -
+ * its iterator yields each word and its count.
+ */
+class concurrent_count_table {
+private:
+  struct slot {
+    std::atomic<std::uint64_t> meta{0}; // tag << 32 | length - zero marks an empty slot
+    std::atomic<const char*> key{nullptr};
+    std::atomic<unsigned int> count{0};
+  };
+
+  struct level {
+    const std::size_t mask;
+    const std::size_t limit; // load limit of the level - 5/8 of its capacity
+    const std::unique_ptr<slot[]> slots;
+    std::atomic<std::size_t> occupied{0};
+    explicit level(std::size_t capacity)
+        : mask(capacity - 1), limit(capacity * 5 / 8), slots(std::make_unique<slot[]>(capacity)) {}
+  };
+
+  static constexpr std::size_t max_levels = 40;
+  static constexpr std::size_t min_capacity = 64 * 1024; // ample headroom for the threads racing a level to its limit
+
+  const std::size_t first_capacity;
+  std::array<std::atomic<level*>, max_levels> levels{};
+  std::mutex arenas_mtx{};
+  std::vector<std::unique_ptr<std::pmr::monotonic_buffer_resource>> arenas{};
+
+  level* add_level(std::size_t k) {
+    auto const fresh = new level(k == 0 ? first_capacity : 2 * (levels[k - 1].load(std::memory_order_acquire)->mask + 1));
+    level *expected = nullptr;
+    if (levels[k].compare_exchange_strong(expected, fresh, std::memory_order_acq_rel)) { return fresh; }
+    delete fresh; // another thread added the level first
+    return expected;
+  }
+
+  void add(const std::string_view word, unsigned int n, std::pmr::memory_resource &arena) {
+    const auto hash = hash_word(word);
+    const auto meta = (hash >> 32 << 32) | static_cast<std::uint32_t>(word.size());
+    for(std::size_t k = 0; k < max_levels; k++) {
+      auto lv = levels[k].load(std::memory_order_acquire);
+      if (lv == nullptr) { lv = add_level(k); }
+      for(auto i = static_cast<std::size_t>(hash) & lv->mask;; i = (i + 1) & lv->mask) {
+        auto &s = lv->slots[i];
+        auto m = s.meta.load(std::memory_order_acquire);
+        if (m == 0) {
+          if (lv->occupied.load(std::memory_order_relaxed) >= lv->limit) { break; } // on to the next level
+          if (s.meta.compare_exchange_strong(m, meta, std::memory_order_acq_rel)) {
+            lv->occupied.fetch_add(1, std::memory_order_relaxed);
+            auto const key = static_cast<char*>(arena.allocate(word.size(), 1));
+            std::memcpy(key, word.data(), word.size());
+            s.count.fetch_add(n, std::memory_order_relaxed);
+            s.key.store(key, std::memory_order_release);
+            return;
+          }
+          // lost the race for the slot - m is now the meta word of the winner
+        }
+        if (m == meta) {
+          const char *key;
+          while ((key = s.key.load(std::memory_order_acquire)) == nullptr) { std::this_thread::yield(); }
+          if (std::memcmp(key, word.data(), word.size()) == 0) {
+            s.count.fetch_add(n, std::memory_order_relaxed);
+            return;
+          }
+        }
+      }
+    }
+  }
+
+  /**
+   * Looks up a word in one level (once the counting threads are done).
+   *
+   * @return the slot of the word, or nullptr when it's not in the level
+   * - and the number of slots inspected
+   */
+  static std::pair<slot*, std::size_t> find(const level &lv, const std::string_view word, std::uint64_t hash) {
+    const auto meta = (hash >> 32 << 32) | static_cast<std::uint32_t>(word.size());
+    std::size_t probes = 1;
+    for(auto i = static_cast<std::size_t>(hash) & lv.mask;; i = (i + 1) & lv.mask, probes++) {
+      auto &s = lv.slots[i];
+      const auto m = s.meta.load(std::memory_order_relaxed);
+      if (m == 0) { return {nullptr, probes}; }
+      if (m == meta && std::memcmp(s.key.load(std::memory_order_relaxed), word.data(), word.size()) == 0) {
+        return {&s, probes};
+      }
+    }
+  }
+
+  static std::string_view word_of(const slot &s) noexcept {
+    return {s.key.load(std::memory_order_relaxed), static_cast<std::uint32_t>(s.meta.load(std::memory_order_relaxed))};
+  }
+
+public:
+  /**
+   * Iterates the words of the table and their counts - a word that
+   * consolidate() folded into an earlier level is skipped.
+   */
+  class iterator {
+  private:
+    const concurrent_count_table *table = nullptr;
+    std::size_t k = max_levels;
+    std::size_t i = 0;
+    void skip_empty() noexcept {
+      for(const level *lv; k < max_levels && (lv = table->levels[k].load(std::memory_order_acquire)) != nullptr;) {
+        if (i > lv->mask) {
+          k++;
+          i = 0;
+        } else if (lv->slots[i].meta.load(std::memory_order_relaxed) == 0 ||
+                   lv->slots[i].count.load(std::memory_order_relaxed) == 0) {
+          i++;
+        } else {
+          return;
+        }
+      }
+      k = max_levels;
+      i = 0;
+    }
+  public:
+    using iterator_concept = std::forward_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = std::pair<std::string_view, unsigned int>;
+    iterator() = default;
+    iterator(const concurrent_count_table *counts, std::size_t first_level) noexcept : table(counts), k(first_level) {
+      skip_empty();
+    }
+    value_type operator*() const noexcept {
+      const auto &s = table->levels[k].load(std::memory_order_relaxed)->slots[i];
+      return {word_of(s), s.count.load(std::memory_order_relaxed)};
+    }
+    iterator& operator++() noexcept { ++i; skip_empty(); return *this; }
+    iterator operator++(int) noexcept { auto prior = *this; ++*this; return prior; }
+    bool operator==(const iterator &other) const noexcept { return k == other.k && i == other.i; }
+  };
+  using value_type [[maybe_unused]] = iterator::value_type;
+
+  /**
+   * Counts words into the table on behalf of one thread.
+   */
+  class writer {
+  private:
+    concurrent_count_table &table;
+    std::pmr::memory_resource &arena;
+  public:
+    writer(concurrent_count_table &counts, std::pmr::memory_resource &key_arena) : table(counts), arena(key_arena) {}
+
+    void add(const std::string_view word, unsigned int n = 1) { table.add(word, n, arena); }
+  };
+
+  /**
+   * @param expected_words anticipated number of distinct words - the
+   * first level is sized to hold them all (zero for the minimum size)
+   */
+  explicit concurrent_count_table(std::size_t expected_words = 0)
+      : first_capacity(std::max(min_capacity, std::bit_ceil(expected_words * 8 / 5 + 1))) {
+    add_level(0);
+  }
+  concurrent_count_table(const concurrent_count_table&) = delete;
+  concurrent_count_table(concurrent_count_table&&) = delete;
+  concurrent_count_table& operator=(const concurrent_count_table&) = delete;
+  concurrent_count_table& operator=(concurrent_count_table&&) = delete;
+  ~concurrent_count_table() {
+    for(auto &entry : levels) { delete entry.load(std::memory_order_acquire); }
+  }
+
+  /**
+   * Makes a writer for a counting thread (safe to call from any thread).
+   *
+   * @return writer with a key arena of its own
+   */
+  writer make_writer() {
+    std::lock_guard lock{arenas_mtx};
+    arenas.push_back(std::make_unique<std::pmr::monotonic_buffer_resource>(256 * 1024));
+    return {*this, *arenas.back()};
+  }
+
+  /**
+   * Folds each word that a race left in two levels into the earlier of
+   * them, so that the table holds each word once - to be called only
+   * once the counting threads are done.
+   */
+  void consolidate() {
+    for(std::size_t k = 1; k < max_levels; k++) {
+      const auto lv = levels[k].load(std::memory_order_acquire);
+      if (lv == nullptr) { break; }
+      for(std::size_t i = 0; i <= lv->mask; i++) {
+        auto &s = lv->slots[i];
+        if (s.meta.load(std::memory_order_relaxed) == 0) { continue; }
+        const auto word = word_of(s);
+        const auto hash = hash_word(word);
+        for(std::size_t j = 0; j < k; j++) {
+          if (const auto [earlier, probes] = find(*levels[j].load(std::memory_order_relaxed), word, hash); earlier != nullptr) {
+            // (the slot stays claimed, with a count of zero, so that the probe sequences through it still hold)
+            earlier->count.fetch_add(s.count.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+            lv->occupied.fetch_sub(1, std::memory_order_relaxed);
+            break;
+          }
+        }
+      }
+    }
+  }
+
+  /** @return count of the words in the table (once consolidated) */
+  [[nodiscard]] std::size_t size() const noexcept {
+    std::size_t n = 0;
+    for(const auto &entry : levels) {
+      if (const auto lv = entry.load(std::memory_order_acquire); lv != nullptr) {
+        n += lv->occupied.load(std::memory_order_relaxed);
+      }
+    }
+    return n;
+  }
+
+  /** @return ratio of the words to the slots of all of the levels */
+  [[nodiscard]] float load_factor() const noexcept {
+    std::size_t capacity = 0;
+    for(const auto &entry : levels) {
+      if (const auto lv = entry.load(std::memory_order_acquire); lv != nullptr) { capacity += lv->mask + 1; }
+    }
+    return static_cast<float>(size()) / static_cast<float>(capacity);
+  }
+
+  /**
+   * Probe sequence lengths - slots inspected by a successful lookup of
+   * each word, including the probes of the levels before its own.
+   *
+   * @return pair of the mean and the maximum probe length
+   */
+  [[nodiscard]] std::pair<double, std::size_t> probe_lengths() const {
+    std::size_t total = 0, longest = 0, n_words = 0;
+    for(const auto [word, count] : *this) {
+      const auto hash = hash_word(word);
+      std::size_t length = 0;
+      for(std::size_t k = 0; k < max_levels; k++) {
+        const auto [found, probes] = find(*levels[k].load(std::memory_order_relaxed), word, hash);
+        length += probes;
+        if (found != nullptr) { break; }
+      }
+      total += length;
+      longest = std::max(longest, length);
+      n_words++;
+    }
+    return {n_words > 0 ? static_cast<double>(total) / static_cast<double>(n_words) : 0.0, longest};
+  }
+
+  [[nodiscard]] iterator begin() const noexcept { return {this, 0}; }
+
+  [[nodiscard]] iterator end() const noexcept { return {}; }
+};
+
+/**
+ * The counting kernel for a thread counting into a concurrent_count_table.
+ *
+ * @param counts writer of the counting thread
+ * @param word the word to count
+ * @param n number of occurrences to add to the count
+ */
+inline void count_word(concurrent_count_table::writer &counts, const std::string_view word, unsigned int n = 1) {
+  counts.add(word, n);
+}
+
+#endif //CONCURRENT_COUNT_TABLE_H
@@ -0,0 +1,136 @@
+/* count_bench.cpp
+
+Copyright 2023 Roger D. Voss
+
+Created by github user roger-dv on 04/08/2023.
+
+Licensed under the MIT License - refer to LICENSE project document.
+
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "bench_corpus.h"
+#include "concurrent_count_table.h"
+#include "count_occurrences.h"
+
+// Micro-benchmark of the word counting kernel. Reports the cost per token of:
+//   before - the original kernel: std::string tokens, counts.find() then counts[] = new_count
+//   std    - count_word() on std::unordered_map with heterogeneous std::string_view lookup
+//   flat   - count_word() on flat_count_table (single hash, single probe sequence)
+// and of the two strategies of counting on several threads (the tokens split evenly between them):
+//   merged - each thread counts into a flat_count_table of its own, which are then merged
+//   shared - all threads count into the one concurrent_count_table (then consolidated, to be read in place)
+//
+// usage: wrd-frq-rngs-count-bench [tokens] [vocabulary] [threads]
+
+namespace {
+
+// deterministic Zipf distributed tokens drawn from a vocabulary of random lowercase words
+std::vector<std::string> make_tokens(std::size_t n_tokens, std::size_t n_vocab) {
+  std::mt19937_64 rng{42};
+  const auto vocab = make_vocabulary(rng, n_vocab);
+  zipf_distribution zipf{n_vocab};
+  std::vector<std::string> tokens(n_tokens);
+  std::ranges::generate(tokens, [&] { return vocab[zipf(rng)]; });
+  return tokens;
+}
+
+template<typename F>
+double ns_per_token(std::size_t n_tokens, F &&run) {
+  constexpr int reps = 5;
+  double best = 1e300;
+  for(int i = 0; i < reps; i++) {
+    const auto start = std::chrono::steady_clock::now();
+    run();
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count() / static_cast<double>(n_tokens));
+  }
+  return best;
+}
+
+// runs count_slice(i, slice) on a thread for each of n slices of the tokens
+template<typename F>
+void on_threads(const std::vector<std::string_view> &tokens, unsigned int n, F &&count_slice) {
+  std::vector<std::jthread> threads{};
+  const auto slice_size = (tokens.size() + n - 1) / n;
+  for(unsigned int i = 0; i < n; i++) {
+    const auto first = std::min(tokens.size(), i * slice_size);
+    const auto last = std::min(tokens.size(), first + slice_size);
+    threads.emplace_back([&count_slice, i, slice = std::vector<std::string_view>(tokens.begin() + first,
+                                                                                  tokens.begin() + last)] {
+      count_slice(i, slice);
+    });
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const std::size_t n_tokens = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4'000'000;
+  const std::size_t n_vocab = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200'000;
+  const auto n_threads = static_cast<unsigned int>(
+      argc > 3 ? std::strtoul(argv[3], nullptr, 10) : std::max(2u, std::thread::hardware_concurrency()));
+  const auto tokens = make_tokens(n_tokens, n_vocab);
+  const std::vector<std::string_view> token_views(tokens.begin(), tokens.end());
+
+  // each table starts out presized the same, for the size of the vocabulary
+  std::size_t distinct = 0;
+  const auto before = ns_per_token(n_tokens, [&] {
+    std::unordered_map<std::string, unsigned int> counts{};
+    counts.reserve(n_vocab);
+    std::ranges::for_each(tokens, [&counts](const std::string &elem) {
+      unsigned int new_count = 1;
+      if (auto search = counts.find(elem); search != counts.end()) {
+        new_count += search->second;
+      }
+      counts[elem] = new_count;
+    });
+    distinct = counts.size();
+  });
+  const auto std_map = ns_per_token(n_tokens, [&] {
+    std_count_table_t counts{};
+    counts.reserve(n_vocab);
+    std::ranges::for_each(token_views, [&counts](std::string_view elem) { count_word(counts, elem); });
+    distinct = counts.size();
+  });
+  const auto flat = ns_per_token(n_tokens, [&] {
+    flat_count_table counts{};
+    counts.reserve(n_vocab);
+    std::ranges::for_each(token_views, [&counts](std::string_view elem) { count_word(counts, elem); });
+    distinct = counts.size();
+  });
+
+  const auto merged = ns_per_token(n_tokens, [&] {
+    std::vector<flat_count_table> local_counts(n_threads);
+    on_threads(token_views, n_threads, [&local_counts, n_vocab](unsigned int i, const auto &slice) {
+      local_counts[i].reserve(n_vocab);
+      std::ranges::for_each(slice, [&counts = local_counts[i]](std::string_view elem) { count_word(counts, elem); });
+    });
+    auto counts = std::move(local_counts[0]);
+    std::for_each(local_counts.begin() + 1, local_counts.end(), [&counts](const auto &t) { merge_counts(counts, t); });
+    distinct = counts.size();
+  });
+  const auto shared = ns_per_token(n_tokens, [&] {
+    concurrent_count_table shared_counts{n_vocab};
+    on_threads(token_views, n_threads, [&shared_counts](unsigned int, const auto &slice) {
+      auto counts = shared_counts.make_writer();
+      std::ranges::for_each(slice, [&counts](std::string_view elem) { count_word(counts, elem); });
+    });
+    shared_counts.consolidate();
+    distinct = shared_counts.size();
+  });
+
+  printf("tokens: %zu, distinct words: %zu, threads: %u\n", n_tokens, distinct, n_threads);
+  printf("%-8s %8.2f ns/token\n", "before", before);
+  printf("%-8s %8.2f ns/token\n", "std", std_map);
+  printf("%-8s %8.2f ns/token\n", "flat", flat);
+  printf("%-8s %8.2f ns/token\n", "merged", merged);
+  printf("%-8s %8.2f ns/token\n", "shared", shared);
+}
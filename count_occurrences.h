@@ -0,0 +1,175 @@
+/* count_occurrences.h
+
+Copyright 2023 Roger D. Voss
+
+Created by github user roger-dv on 04/08/2023.
+
+Licensed under the MIT License - refer to LICENSE project document.
+
+*/
+#ifndef COUNT_OCCURRENCES_H
+#define COUNT_OCCURRENCES_H
+
+#include <algorithm>
+#include <functional>
+#include <memory_resource>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "flat_count_table.h"
+
+/**
+ * Hash function object for std::string keys that can also be
+ * applied to std::string_view (and anything else convertible
+ * to std::string_view), which enables heterogeneous lookup in
+ * unordered containers - a lookup by std::string_view then does
+ * not need to construct a temporary std::string key.
+ */
+struct string_hash {
+  using is_transparent [[maybe_unused]] = void;
+  std::size_t operator()(const std::string_view str) const noexcept {
+    return std::hash<std::string_view>{}(str);
+  }
+};
+
+// the nodes and keys of the std::unordered_map are allocated from a polymorphic memory resource
+using std_count_table_t = std::pmr::unordered_map<std::pmr::string, unsigned int, string_hash, std::equal_to<>>;
+
+#ifdef FLAT_COUNT_TABLE
+using count_table_t = flat_count_table;
+#else
+using count_table_t = std_count_table_t;
+#endif
+
+/**
+ * The counting kernel - adds to the count of a word (by one
+ * occurrence unless told otherwise), inserting the word if this
+ * is its first occurrence.
+ *
+ * For flat_count_table this is a single hash and a single probe
+ * sequence whether the word is found or inserted; the key bytes
+ * are copied into the table's arena only on insertion.
+ *
+ * @param counts table of word counts
+ * @param word the word to count
+ * @param n number of occurrences to add to the count
+ */
+inline void count_word(flat_count_table &counts, const std::string_view word, unsigned int n = 1) {
+  counts[word] += n;
+}
+
+/**
+ * The counting kernel for std::unordered_map - a hit is a single
+ * heterogeneous lookup that doesn't allocate. A miss (which only
+ * occurs once per distinct word) has to hash again to emplace a
+ * std::string key, as std::unordered_map has no heterogeneous
+ * try_emplace() prior to C++26.
+ *
+ * @param counts table of word counts
+ * @param word the word to count
+ * @param n number of occurrences to add to the count
+ */
+inline void count_word(std_count_table_t &counts, const std::string_view word, unsigned int n = 1) {
+  if (auto search = counts.find(word); search != counts.end()) {
+    search->second += n;
+  } else {
+    counts.emplace(word, n);
+  }
+}
+
+/**
+ * Merges the counts of one count table into another.
+ *
+ * @tparam Table type of the count tables
+ * @param into table that accumulates the merged counts
+ * @param from table whose counts are added in
+ */
+template<typename Table>
+void merge_counts(Table &into, const Table &from) {
+  std::ranges::for_each(from, [&into](const auto &entry) { count_word(into, entry.first, entry.second); });
+}
+
+/**
+ * Merges the count tables of several threads into one - the largest
+ * of them, which is moved from, so that the fewest words are re-counted.
+ *
+ * @tparam Table type of the count tables
+ * @param tables the tables to merge (are left moved from or unchanged)
+ * @return the merged count table
+ */
+template<typename Table>
+Table merge_tables(std::vector<Table> &tables) {
+  auto largest = std::ranges::max_element(tables, {}, [](const Table &t) { return t.size(); });
+  auto counts = std::move(*largest);
+  std::ranges::for_each(tables, [&counts, merged = &*largest](const Table &t) {
+    if (&t != merged) { merge_counts(counts, t); }
+  });
+  return counts;
+}
+
+/**
+ * Counts each of a list of words.
+ *
+ * @tparam Counts type of the count table (or of the writer of one)
+ * @param counts table the words are counted into
+ * @param words the words to count
+ */
+template<typename Counts>
+void count_words(Counts &counts, const std::vector<std::string_view> &words) {
+  std::ranges::for_each(words, [&counts](const std::string_view word) { count_word(counts, word); });
+}
+
+/**
+ * Counts the occurrence of string tokens in the range
+ * passed as the input.
+ *
+ * The range is consumed in a single pass and each token is
+ * counted as it arrives, so the input range can be a lazy
+ * evaluated stream of tokens (no collection of all the tokens
+ * is ever materialized) - memory use is thereby governed by
+ * the number of distinct tokens rather than total tokens.
+ *
+ * A std::string key is only constructed the first time a
+ * distinct token is encountered; repeat occurrences of the
+ * token are looked up without any allocation.
+ *
+ * By default the table that the counts are accumulated in is
+ * chosen at compile time: when FLAT_COUNT_TABLE is defined it's
+ * the open addressing flat_count_table, else std::unordered_map.
+ *
+ * @tparam Table type of the count table to accumulate into
+ * @tparam R input range type of string tokens (can be a
+ * single pass input range)
+ * @tparam T string type of a range element (must
+ * be possible to construct std::string from T)
+ * @param tokens an input range of string tokens
+ * @param word_storage memory resource that the table allocates
+ * its words from (such as a std::pmr::monotonic_buffer_resource,
+ * so that the words land in large slabs which are released all at
+ * once) - or nullptr for the default allocation of the table
+ * @param expected_words estimate of the number of distinct words
+ * (such as from estimate_vocabulary()) that the table is presized
+ * for - or zero for the table to be sized from the range size when
+ * the range is sized, else to start out small and grow
+ * @return count table (an unordered map) where key is a string
+ * token from the input and its associated value is count of
+ * its occurrence in the range.
+ */
+template <typename Table = count_table_t, typename R, typename T = std::ranges::range_reference_t<R>>
+    requires std::ranges::input_range<R> && std::constructible_from<std::string, T>
+auto count_occurrences(R &&tokens, std::pmr::memory_resource *word_storage = nullptr, std::size_t expected_words = 0) {
+  Table counts = word_storage != nullptr ? Table{word_storage} : Table{};
+  if (expected_words > 0) {
+    counts.reserve(expected_words);
+  } else if constexpr (std::ranges::sized_range<R>) {
+    counts.reserve(std::ranges::size(tokens) * 5 / 3);
+  } else {
+    counts.reserve(8 * 1024);
+  }
+  std::ranges::for_each(tokens, [&counts](const T& elem) { count_word(counts, elem); });
+  return counts;
+}
+
+#endif //COUNT_OCCURRENCES_H
@@ -0,0 +1,186 @@
+/* diagnostics.h
+
+Copyright 2023 Roger D. Voss
+
+Created by github user roger-dv on 04/08/2023.
+
+Licensed under the MIT License - refer to LICENSE project document.
+
+*/
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <ranges>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "heavy_hitters.h"
+#include "hyperloglog.h"
+#include "output_sink.h"
+#include "ranking.h"
+#include "string_sort.h"
+
+/**
+ * The diagnostics that are written to stderr (selected on the
+ * command line).
+ */
+enum class diagnostics_mode {
+  none, // quiet - nothing is written to stderr
+  text, // the human readable DEBUG report
+  json  // the same report as a single JSON object
+};
+
+/**
+ * Obtains the set of distinct word counts, from largest to smallest.
+ * They simply fall out of the ranked pairs in O(V).
+ *
+ * @param count_pairs ranked count pairs
+ * @return the distinct word counts in descending order
+ */
+inline std::vector<unsigned int> distinct_counts(const std::vector<count_pair_t> &count_pairs) {
+  std::vector<unsigned int> just_counts{};
+  std::ranges::unique_copy(std::views::keys(count_pairs), std::back_inserter(just_counts));
+  return just_counts;
+}
+
+/**
+ * Obtains the sorted set of words that were counted - the keys of
+ * the count table, so only the vocabulary is sorted and not every
+ * token of the input.
+ *
+ * @tparam Table type of the count table
+ * @param counts_map the word counts
+ * @return the counted words in lexical order
+ */
+template<typename Table>
+std::vector<std::string_view> sorted_vocabulary(const Table &counts_map) {
+  std::vector<std::string_view> words{};
+  words.reserve(counts_map.size());
+  std::ranges::copy(std::views::keys(counts_map), std::back_inserter(words));
+  multikey_quicksort(words.begin(), words.end(), [](const std::string_view word) { return word; });
+  return words;
+}
+
+inline void print_text_count_set(const std::vector<unsigned int> &just_counts) {
+  output_sink err{STDERR_FILENO};
+  err << "\nDEBUG: word-count-set: { ";
+  std::ranges::for_each(just_counts, [&err](const auto n) { err << n << ' '; });
+  err << "}\n";
+  err << "\nDEBUG: word-count-set size: " << just_counts.size() << "\n\n";
+  err.flush();
+}
+
+inline void print_text_counted_words(const std::vector<std::string_view> &words) {
+  output_sink err{STDERR_FILENO};
+  err << "\nDEBUG: counted words:\n";
+  std::ranges::for_each(words, [&err](const auto word) { err << word << '\n'; });
+  err.flush();
+}
+
+/**
+ * Writes the diagnostics report to stderr as one JSON object on a
+ * single line. (The words need no escaping as they can only consist
+ * of alpha characters, '-', '_' and '#'.)
+ *
+ * @param just_counts the distinct word counts
+ * @param words the counted words in lexical order
+ */
+inline void print_json_diagnostics(const std::vector<unsigned int> &just_counts,
+                                   const std::vector<std::string_view> &words) {
+  output_sink err{STDERR_FILENO};
+  err << "{\"word_count_set_size\":" << just_counts.size() << ",\"word_count_set\":[";
+  std::string_view separator{};
+  std::ranges::for_each(just_counts, [&](const auto n) { err << separator << n; separator = ","; });
+  err << "],\"counted_words_size\":" << words.size() << ",\"counted_words\":[";
+  separator = {};
+  std::ranges::for_each(words, [&](const auto word) { err << separator << '"' << word << '"'; separator = ","; });
+  err << "]}\n";
+  err.flush();
+}
+
+/**
+ * Obtains the error of the count of each ranked heavy hitter - the
+ * count of the word can be over its true count by up to the error.
+ *
+ * @param sketch the heavy hitters sketch that the words were counted in
+ * @param count_pairs ranked count pairs of the monitored words
+ * @return the error of each count pair, in the same order
+ */
+inline std::vector<unsigned int> heavy_hitter_errors(const space_saving &sketch,
+                                                     const std::vector<count_pair_t> &count_pairs) {
+  std::unordered_map<std::string_view, unsigned int> errors{};
+  errors.reserve(sketch.monitored().size());
+  std::ranges::for_each(sketch.monitored(), [&errors](const auto &c) { errors.emplace(c.word, c.error); });
+  std::vector<unsigned int> ranked_errors{};
+  ranked_errors.reserve(count_pairs.size());
+  std::ranges::transform(std::views::values(count_pairs), std::back_inserter(ranked_errors),
+                         [&errors](const auto word) { return errors.at(word); });
+  return ranked_errors;
+}
+
+inline void print_text_heavy_hitters(const space_saving &sketch, const std::vector<count_pair_t> &count_pairs) {
+  const auto errors = heavy_hitter_errors(sketch, count_pairs);
+  output_sink err{STDERR_FILENO};
+  err << "\nDEBUG: heavy hitters: " << sketch.stream_size() << " words counted in "
+      << sketch.counter_capacity() << " counters - a count is over by at most " << sketch.error_bound() << '\n';
+  err << "\nDEBUG: heavy hitters (count: word [true count range]):\n";
+  for(std::size_t i = 0; i < count_pairs.size(); i++) {
+    const auto &[count, word] = count_pairs[i];
+    err << count << ": " << word << " [" << count - errors[i] << ", " << count << "]\n";
+  }
+  err.flush();
+}
+
+/**
+ * Writes the heavy hitters report to stderr as one JSON object on a
+ * single line - each word with its count and the error of its count.
+ *
+ * @param sketch the heavy hitters sketch that the words were counted in
+ * @param count_pairs ranked count pairs of the monitored words
+ */
+inline void print_json_heavy_hitters(const space_saving &sketch, const std::vector<count_pair_t> &count_pairs) {
+  const auto errors = heavy_hitter_errors(sketch, count_pairs);
+  output_sink err{STDERR_FILENO};
+  err << "{\"stream_words\":" << sketch.stream_size() << ",\"counters\":" << sketch.counter_capacity()
+      << ",\"error_bound\":" << sketch.error_bound() << ",\"heavy_hitters\":[";
+  for(std::size_t i = 0; i < count_pairs.size(); i++) {
+    err << (i > 0 ? "," : "") << "{\"word\":\"" << count_pairs[i].second << "\",\"count\":" << count_pairs[i].first
+        << ",\"error\":" << errors[i] << '}';
+  }
+  err << "]}\n";
+  err.flush();
+}
+
+/**
+ * Prints the estimated number of distinct words to stdout and, as
+ * diagnostics to stderr, the error of the estimate.
+ *
+ * @param sketch the sketch of the words
+ * @param mode what is reported to stderr
+ */
+inline void print_distinct_estimate(const hyperloglog &sketch, const diagnostics_mode mode) {
+  const auto estimate = static_cast<std::uint64_t>(std::llround(sketch.estimate()));
+  {
+    output_sink out{STDOUT_FILENO};
+    out << estimate << '\n';
+    out.flush();
+  }
+  char error[32];
+  std::snprintf(error, sizeof(error), "%.4f", sketch.standard_error());
+  output_sink err{STDERR_FILENO};
+  if (mode == diagnostics_mode::text) {
+    err << "\nDEBUG: distinct words estimate: " << estimate << " (relative standard error " << error
+        << ", HyperLogLog of " << sketch.register_count() << " registers)\n";
+  } else if (mode == diagnostics_mode::json) {
+    err << "{\"distinct_estimate\":" << estimate << ",\"standard_error\":" << error
+        << ",\"registers\":" << sketch.register_count() << "}\n";
+  }
+  err.flush();
+}
+
+#endif //DIAGNOSTICS_H
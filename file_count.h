@@ -0,0 +1,204 @@
+/* file_count.h
+
+Copyright 2023 Roger D. Voss
+
+Created by github user roger-dv on 04/08/2023.
+
+Licensed under the MIT License - refer to LICENSE project document.
+
+*/
+#ifndef FILE_COUNT_H
+#define FILE_COUNT_H
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <filesystem>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "count_occurrences.h"
+#include "input_source.h"
+#include "tokenizer.h"
+
+/**
+ * An input file named on the command line (or found by walking
+ * a directory named on the command line).
+ */
+struct input_file {
+  std::filesystem::path path;
+  std::uintmax_t size = 0;
+};
+
+/**
+ * Expands the command line paths into the list of input files. A
+ * directory is walked recursively and its regular files are taken
+ * in lexical order of their paths, so the order of the input files
+ * is that of the command line and is reproducible. A file named on
+ * the command line that isn't a regular file (a pipe or a device) is
+ * read all the same - having no size, it's scheduled after the regular
+ * files.
+ *
+ * @param paths the file and directory paths
+ * @return the input files, or the error of the first path that
+ * can't be accessed
+ */
+inline std::vector<input_file> collect_input_files(const std::vector<std::filesystem::path> &paths) {
+  namespace fs = std::filesystem;
+  std::vector<input_file> files{};
+  for(const auto &path : paths) {
+    const auto status = fs::status(path);
+    if (!fs::is_directory(status)) {
+      files.push_back({path, fs::is_regular_file(status) ? fs::file_size(path) : 0});
+      continue;
+    }
+    std::vector<input_file> found{};
+    for(const auto &entry : fs::recursive_directory_iterator{path}) {
+      if (entry.is_regular_file()) { found.push_back({entry.path(), entry.file_size()}); }
+    }
+    std::ranges::sort(found, {}, &input_file::path);
+    std::ranges::move(found, std::back_inserter(files));
+  }
+  return files;
+}
+
+/**
+ * The partial tokens at either end of an input file. A token at the
+ * very start or very end of a file can run on into the adjoining file
+ * (as it would if the files were concatenated) so these are not counted
+ * by the workers - they are pieced together in file order afterwards.
+ */
+struct file_fragments {
+  std::string head{};  // text before the first whitespace of the file
+  std::string tail{};  // text after the last whitespace of the file
+  bool whole = true;   // the file has no whitespace at all (head is all of it)
+};
+
+/**
+ * Counts the words of one input file, less the tokens at either end
+ * of it, which are instead returned as its fragments.
+ */
+template<typename Table>
+file_fragments count_file(const input_file &file, Table &counts, word_splitter &splitter,
+                          std::vector<std::string_view> &words, std::size_t &bytes_read) {
+  const int fd = ::open(file.path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) { throw std::system_error(errno, std::generic_category(), file.path.string()); }
+  file_fragments fragments{};
+  try {
+    input_source source{fd};
+    while (auto text = source.next_chunk()) {
+      auto chunk = *text;
+      if (fragments.whole) {
+        const auto first_space = std::ranges::find_if(chunk, is_space_char);
+        fragments.head.assign(chunk.begin(), first_space);
+        if (first_space == chunk.end()) { continue; } // only the end of input can be without whitespace
+        fragments.whole = false;
+        chunk.remove_prefix(fragments.head.size());
+      }
+      // a chunk ends with whitespace unless it's the last chunk
+      const auto last_space = std::ranges::find_if(chunk.rbegin(), chunk.rend(), is_space_char).base();
+      fragments.tail.assign(last_space, chunk.end());
+      chunk.remove_suffix(fragments.tail.size());
+      splitter.split(chunk, words);
+      count_words(counts, words);
+    }
+    bytes_read += source.bytes_read();
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  ::close(fd);
+  return fragments;
+}
+
+/**
+ * Counts the occurrence of the words of a list of input files using
+ * a pool of worker threads. The files are handed out largest first
+ * (so a big file isn't left to the last) and each worker counts into
+ * a worker local table; the local tables are then merged into one.
+ *
+ * The counts are exactly those of counting the concatenation of the
+ * files in list order - a token that runs across the end of one file
+ * into the next is counted as the one token.
+ *
+ * @tparam Table type of the count table to accumulate into
+ * @param files the input files
+ * @param n_threads number of counting worker threads
+ * @param tally when not nullptr, the tally of the tokens seen is
+ * added to it
+ * @param bytes_read when not nullptr, the count of the bytes of
+ * input read is added to it
+ * @return count table where key is a word from the input and its
+ * associated value is count of its occurrence in the input.
+ */
+template<typename Table = count_table_t>
+Table count_files(const std::vector<input_file> &files, unsigned int n_threads,
+                  token_tally *tally = nullptr, std::size_t *bytes_read = nullptr) {
+  n_threads = static_cast<unsigned int>(std::clamp<std::size_t>(files.size(), 1, n_threads));
+  std::vector<std::size_t> schedule(files.size());
+  std::iota(schedule.begin(), schedule.end(), 0);
+  std::ranges::stable_sort(schedule, std::ranges::greater{}, [&files](const auto i) { return files[i].size; });
+
+  std::vector<file_fragments> fragments(files.size());
+  std::vector<Table> local_counts(n_threads);
+  std::vector<token_tally> local_tallies(n_threads);
+  std::vector<std::size_t> local_bytes(n_threads);
+  std::vector<std::exception_ptr> errors(n_threads);
+  std::atomic<std::size_t> next_file{0};
+  auto const worker = [&](const unsigned int w) {
+    word_splitter splitter{};
+    std::vector<std::string_view> words{};
+    try {
+      for(auto n = next_file++; n < schedule.size(); n = next_file++) {
+        const auto i = schedule[n];
+        fragments[i] = count_file(files[i], local_counts[w], splitter, words, local_bytes[w]);
+      }
+    } catch (...) {
+      errors[w] = std::current_exception();
+      next_file = schedule.size(); // the other workers stop early
+    }
+    local_tallies[w] = splitter.tally();
+  };
+  if (n_threads == 1) {
+    worker(0);
+  } else {
+    std::vector<std::jthread> workers{};
+    workers.reserve(n_threads);
+    for(unsigned int w = 0; w < n_threads; w++) { workers.emplace_back(worker, w); }
+  } // workers are joined here
+  for(const auto &error : errors) {
+    if (error) { std::rethrow_exception(error); }
+  }
+
+  auto counts = merge_tables(local_counts);
+
+  // piece together the tokens that span the ends of the files, in file order
+  word_splitter splitter{};
+  std::vector<std::string_view> words{};
+  std::string pending{};
+  auto const count_pending = [&] {
+    if (pending.empty()) { return; }
+    splitter.split(pending, words);
+    count_words(counts, words);
+    pending.clear();
+  };
+  for(auto &f : fragments) {
+    pending += f.head;
+    if (f.whole) { continue; }
+    count_pending();
+    pending = std::move(f.tail);
+  }
+  count_pending();
+
+  local_tallies.push_back(splitter.tally());
+  add_tallies(tally, local_tallies);
+  if (bytes_read != nullptr) { *bytes_read += std::reduce(local_bytes.begin(), local_bytes.end()); }
+  return counts;
+}
+
+#endif //FILE_COUNT_H
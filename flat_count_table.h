@@ -0,0 +1,213 @@
+/* flat_count_table.h
+
+Copyright 2023 Roger D. Voss
+
+Created by github user roger-dv on 04/08/2023.
+
+Licensed under the MIT License - refer to LICENSE project document.
+
+*/
+#ifndef FLAT_COUNT_TABLE_H
+#define FLAT_COUNT_TABLE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * Hashes the bytes of a word eight bytes at a time, folding
+ * each 64-bit word of input through a 128-bit multiply. The
+ * low bits of the result are used to index a hash table and
+ * its high bits as a fingerprint, so all bits are well mixed.
+ *
+ * @param word the text string to hash
+ * @return 64-bit hash of the word
+ */
+inline std::uint64_t hash_word(const std::string_view word) noexcept {
+  constexpr std::uint64_t k0 = 0x9e3779b97f4a7c15ull, k1 = 0xbf58476d1ce4e5b9ull;
+  auto const fold_mul = [](std::uint64_t a, std::uint64_t b) {
+    const auto m = static_cast<unsigned __int128>(a) * b;
+    return static_cast<std::uint64_t>(m) ^ static_cast<std::uint64_t>(m >> 64);
+  };
+  auto h = fold_mul(word.size() ^ k1, k0);
+  const char *p = word.data();
+  auto n = word.size();
+  for(; n >= 8; p += 8, n -= 8) {
+    std::uint64_t v;
+    std::memcpy(&v, p, 8);
+    h = fold_mul(h ^ v, k0);
+  }
+  if (n > 0) {
+    std::uint64_t v = 0;
+    std::memcpy(&v, p, n);
+    h = fold_mul(h ^ v, k0);
+  }
+  return fold_mul(h, k1);
+}
+
+/**
+ * An open addressing (linear probing) hash table that maps a
+ * word to its occurrence count - a purpose-built alternative to
+ * std::unordered_map<std::string, unsigned int> for counting.
+ *
+ * The slots are a flat array. Each occupied slot holds, inline,
+ * a hash fingerprint and the length of its word as well as the
+ * count, so a probe only touches the key bytes when fingerprint
+ * and length both match. The key bytes themselves are copied
+ * into large arena slabs when a word is first inserted (instead
+ * of a heap allocation per key) - either the slabs of a memory
+ * resource supplied to the table (which then must outlive the
+ * table), or else of an arena owned by the table, which releases
+ * them all at once when the table is destroyed.
+ *
+ * Iterating the table yields std::pair<std::string_view, unsigned int>
+ * values (in no particular order).
+ */
+class flat_count_table {
+private:
+  struct slot {
+    const char *key = nullptr; // nullptr marks an empty slot
+    std::size_t length = 0;
+    std::uint32_t tag = 0;     // high bits of the hash
+    unsigned int count = 0;
+  };
+
+  static constexpr std::size_t min_capacity = 16;
+
+  std::vector<slot> slots{};
+  std::size_t mask = 0;
+  std::size_t occupied = 0;
+  std::unique_ptr<std::pmr::monotonic_buffer_resource> own_arena{};
+  std::pmr::memory_resource *key_storage = nullptr;
+
+  static std::size_t capacity_for(std::size_t n) noexcept {
+    // keep the load factor at or below 5/8
+    std::size_t capacity = min_capacity;
+    while (capacity * 5 < n * 8) { capacity *= 2; }
+    return capacity;
+  }
+
+  void rehash(std::size_t capacity) {
+    std::vector<slot> prior(capacity);
+    prior.swap(slots);
+    mask = capacity - 1;
+    for(const auto &s : prior) {
+      if (s.key == nullptr) { continue; }
+      auto i = static_cast<std::size_t>(hash_word({s.key, s.length})) & mask;
+      while (slots[i].key != nullptr) { i = (i + 1) & mask; }
+      slots[i] = s;
+    }
+  }
+
+public:
+  class iterator {
+  private:
+    const slot *current = nullptr;
+    const slot *last = nullptr;
+    void skip_empty() noexcept { while (current != last && current->key == nullptr) { ++current; } }
+  public:
+    using iterator_concept = std::forward_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = std::pair<std::string_view, unsigned int>;
+    iterator() = default;
+    iterator(const slot *first, const slot *end) noexcept : current(first), last(end) { skip_empty(); }
+    value_type operator*() const noexcept { return {{current->key, current->length}, current->count}; }
+    iterator& operator++() noexcept { ++current; skip_empty(); return *this; }
+    iterator operator++(int) noexcept { auto prior = *this; ++*this; return prior; }
+    bool operator==(const iterator &other) const noexcept { return current == other.current; }
+  };
+  using value_type [[maybe_unused]] = iterator::value_type;
+
+  /**
+   * @param word_storage memory resource that the key bytes are
+   * allocated from (nullptr for the table to use its own arena)
+   */
+  explicit flat_count_table(std::pmr::memory_resource *word_storage = nullptr) : key_storage(word_storage) {
+    if (key_storage == nullptr) {
+      own_arena = std::make_unique<std::pmr::monotonic_buffer_resource>(64 * 1024);
+      key_storage = own_arena.get();
+    }
+    rehash(min_capacity);
+  }
+
+  /**
+   * Presizes the table so that n distinct words can be
+   * inserted without the table having to grow.
+   *
+   * @param n anticipated number of distinct words
+   */
+  void reserve(std::size_t n) {
+    if (const auto capacity = capacity_for(n); capacity > slots.size()) { rehash(capacity); }
+  }
+
+  /**
+   * Looks up the count of a word, inserting the word with a
+   * count of zero if it is not present yet (the same semantics
+   * as std::unordered_map::operator[]).
+   *
+   * @param word the word to find or insert
+   * @return reference to the count of the word
+   */
+  unsigned int& operator[](const std::string_view word) {
+    const auto hash = hash_word(word);
+    const auto tag = static_cast<std::uint32_t>(hash >> 32);
+    auto i = static_cast<std::size_t>(hash) & mask;
+    for(;;) {
+      auto &s = slots[i];
+      if (s.key == nullptr) { break; }
+      if (s.tag == tag && s.length == word.size() && std::memcmp(s.key, word.data(), word.size()) == 0) {
+        return s.count;
+      }
+      i = (i + 1) & mask;
+    }
+    if ((occupied + 1) * 8 > slots.size() * 5) {
+      rehash(slots.size() * 2);
+      i = static_cast<std::size_t>(hash) & mask;
+      while (slots[i].key != nullptr) { i = (i + 1) & mask; }
+    }
+    auto const key = static_cast<char*>(key_storage->allocate(word.size(), 1));
+    std::memcpy(key, word.data(), word.size());
+    slots[i] = slot{key, word.size(), tag, 0};
+    occupied++;
+    return slots[i].count;
+  }
+
+  [[nodiscard]] std::size_t size() const noexcept { return occupied; }
+
+  [[nodiscard]] float load_factor() const noexcept {
+    return static_cast<float>(occupied) / static_cast<float>(slots.size());
+  }
+
+  /**
+   * Measures the probe sequence lengths of the words in the table -
+   * the number of slots a successful lookup of each word inspects.
+   * (Re-hashes every word so is meant for reporting statistics only.)
+   *
+   * @return pair of the mean and the maximum probe length
+   */
+  [[nodiscard]] std::pair<double, std::size_t> probe_lengths() const {
+    std::size_t total = 0, longest = 0;
+    for(std::size_t i = 0; i < slots.size(); i++) {
+      if (slots[i].key == nullptr) { continue; }
+      const auto home = static_cast<std::size_t>(hash_word({slots[i].key, slots[i].length})) & mask;
+      const auto length = ((i - home) & mask) + 1;
+      total += length;
+      longest = std::max(longest, length);
+    }
+    return {occupied > 0 ? static_cast<double>(total) / static_cast<double>(occupied) : 0.0, longest};
+  }
+
+  [[nodiscard]] iterator begin() const noexcept { return {slots.data(), slots.data() + slots.size()}; }
+
+  [[nodiscard]] iterator end() const noexcept {
+    return {slots.data() + slots.size(), slots.data() + slots.size()};
+  }
+};
+
+#endif //FLAT_COUNT_TABLE_H
@@ -0,0 +1,180 @@
+/* heavy_hitters.h
+
+Copyright 2023 Roger D. Voss
+
+Created by github user roger-dv on 04/08/2023.
+
+Licensed under the MIT License - refer to LICENSE project document.
+
+*/
+#ifndef HEAVY_HITTERS_H
+#define HEAVY_HITTERS_H
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "flat_count_table.h"
+
+/**
+ * Approximate word counting in a fixed amount of memory - the
+ * Space-Saving algorithm (Metwally, Agrawal and El Abbadi, 2005).
+ *
+ * At most capacity words are monitored, each with a counter. A word
+ * that is already monitored has its count incremented. A new word,
+ * once all of the counters are in use, takes over the counter with
+ * the least count c, which becomes c + 1 with an error of c - the
+ * new word may have occurred up to c times before it was monitored.
+ *
+ * So for each monitored word its true count lies in the range
+ * [count - error, count], and no error exceeds N / capacity for a
+ * stream of N words; any word occurring more than N / capacity times
+ * is sure to be monitored.
+ *
+ * The counter of the least count is found with a lazily maintained
+ * min-heap: a count increment doesn't touch the heap, instead a stale
+ * heap entry is refreshed when it surfaces at the top of the heap.
+ * The monitored words are found through an open addressing index
+ * (linear probing, with backward shift deletion for evicted words).
+ */
+class space_saving {
+public:
+  struct counter {
+    std::string word{};
+    unsigned int count = 0;
+    unsigned int error = 0;
+  };
+
+private:
+  struct index_entry {
+    std::uint32_t counter_plus_one = 0; // zero marks an empty entry
+    std::uint32_t tag = 0;              // high bits of the hash of the word
+  };
+  using heap_entry = std::pair<unsigned int, std::uint32_t>; // count when pushed, counter
+
+  std::vector<counter> counters{};
+  std::vector<heap_entry> heap{};
+  std::vector<index_entry> index{};
+  std::size_t mask = 0;
+  std::size_t capacity;
+  std::uint64_t stream_words = 0;
+
+  std::size_t home_of(std::size_t i) const noexcept {
+    return static_cast<std::size_t>(hash_word(counters[index[i].counter_plus_one - 1].word)) & mask;
+  }
+
+  /** @return position in the index of the word, or of the empty entry where it would go */
+  std::size_t find(const std::string_view word, const std::uint64_t hash) const noexcept {
+    const auto tag = static_cast<std::uint32_t>(hash >> 32);
+    auto i = static_cast<std::size_t>(hash) & mask;
+    while (index[i].counter_plus_one != 0 &&
+           (index[i].tag != tag || counters[index[i].counter_plus_one - 1].word != word)) {
+      i = (i + 1) & mask;
+    }
+    return i;
+  }
+
+  void erase(std::size_t i) noexcept {
+    // backward shift deletion - moves up any later entry of the probe run that may then be unreachable
+    for(auto j = (i + 1) & mask; index[j].counter_plus_one != 0; j = (j + 1) & mask) {
+      if (((j - home_of(j)) & mask) >= ((j - i) & mask)) {
+        index[i] = index[j];
+        i = j;
+      }
+    }
+    index[i] = index_entry{};
+  }
+
+  std::uint32_t evict() {
+    for(;;) {
+      const auto [count, c] = heap.front();
+      std::ranges::pop_heap(heap, std::greater{});
+      if (counters[c].count == count) { return c; }
+      heap.back().first = counters[c].count; // stale - push back with its current count
+      std::ranges::push_heap(heap, std::greater{});
+    }
+  }
+
+public:
+  /** the most counters a sketch can have - about 1 GiB of them */
+  static constexpr std::size_t max_counters = std::size_t{1} << 24;
+
+  /**
+   * @param n_counters number of words to monitor (at most max_counters) (the memory used is
+   * fixed by it - about 64 bytes per counter, plus the bytes of any
+   * word longer than 15 characters)
+   */
+  explicit space_saving(std::size_t n_counters) : capacity(std::clamp<std::size_t>(n_counters, 1, max_counters)) {
+    counters.reserve(capacity);
+    heap.reserve(capacity);
+    index.resize(std::bit_ceil(capacity * 2));
+    mask = index.size() - 1;
+  }
+  space_saving(const space_saving&) = delete;
+  space_saving(space_saving&&) = delete;
+  space_saving& operator=(const space_saving&) = delete;
+  space_saving& operator=(space_saving&&) = delete;
+  ~space_saving() = default;
+
+  /**
+   * Counts occurrences of a word.
+   *
+   * @param word the word to count
+   * @param n number of occurrences
+   */
+  void add(const std::string_view word, unsigned int n = 1) {
+    stream_words += n;
+    const auto hash = hash_word(word);
+    auto i = find(word, hash);
+    if (index[i].counter_plus_one != 0) {
+      counters[index[i].counter_plus_one - 1].count += n;
+      return;
+    }
+    std::uint32_t c;
+    if (counters.size() < capacity) {
+      c = static_cast<std::uint32_t>(counters.size());
+      counters.push_back({std::string{word}, n, 0});
+    } else {
+      c = evict();
+      auto &victim = counters[c];
+      erase(find(victim.word, hash_word(victim.word)));
+      i = find(word, hash); // the deletion may have shifted the empty entry for the word
+      victim.word.assign(word); // reuses the buffer of the evicted word when it fits
+      victim.error = victim.count;
+      victim.count += n;
+      heap.pop_back();
+    }
+    index[i] = {c + 1, static_cast<std::uint32_t>(hash >> 32)};
+    heap.emplace_back(counters[c].count, c);
+    std::ranges::push_heap(heap, std::greater{});
+  }
+
+  /** @return the monitored words and their counts */
+  [[nodiscard]] const std::vector<counter>& monitored() const noexcept { return counters; }
+
+  /** @return number of word occurrences counted */
+  [[nodiscard]] std::uint64_t stream_size() const noexcept { return stream_words; }
+
+  /** @return number of counters */
+  [[nodiscard]] std::size_t counter_capacity() const noexcept { return capacity; }
+
+  /** @return the guaranteed bound of the error of any count - N / capacity */
+  [[nodiscard]] std::uint64_t error_bound() const noexcept { return stream_words / capacity; }
+};
+
+/**
+ * The counting kernel for space_saving.
+ *
+ * @param counts the heavy hitters sketch
+ * @param word the word to count
+ * @param n number of occurrences to add to the count
+ */
+inline void count_word(space_saving &counts, const std::string_view word, unsigned int n = 1) {
+  counts.add(word, n);
+}
+
+#endif //HEAVY_HITTERS_H
@@ -0,0 +1,123 @@
+/* hyperloglog.h
+
+Copyright 2023 Roger D. Voss
+
+Created by github user roger-dv on 04/08/2023.
+
+Licensed under the MIT License - refer to LICENSE project document.
+
+*/
+#ifndef HYPERLOGLOG_H
+#define HYPERLOGLOG_H
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "flat_count_table.h"
+#include "input_source.h"
+#include "tokenizer.h"
+
+/**
+ * HyperLogLog sketch (Flajolet, Fusy, Gandouet and Meunier, 2007) -
+ * estimates the number of distinct words of a stream in a fixed
+ * 2^precision bytes, with a standard error of 1.04 / sqrt(2^precision)
+ * (0.81% at the default precision of 14).
+ *
+ * Each word is hashed (hash_word()); the top precision bits of the
+ * hash select a register, which keeps the maximum position of the
+ * first 1 bit seen in the rest of the hash. Small cardinalities, that
+ * leave registers at zero, are estimated by linear counting instead.
+ */
+class hyperloglog {
+private:
+  unsigned int precision;
+  std::vector<std::uint8_t> registers;
+
+public:
+  /** @param bits precision of the sketch - 4 to 18 bits */
+  explicit hyperloglog(unsigned int bits = 14)
+      : precision(std::clamp(bits, 4u, 18u)), registers(std::size_t{1} << precision) {}
+
+  void add(const std::string_view word) noexcept {
+    const auto hash = hash_word(word);
+    const auto r = static_cast<std::size_t>(hash >> (64 - precision));
+    // (a guard bit caps the rank should all the remaining bits be zero)
+    const auto rest = (hash << precision) | (std::uint64_t{1} << (precision - 1));
+    const auto rank = static_cast<std::uint8_t>(std::countl_zero(rest) + 1);
+    registers[r] = std::max(registers[r], rank);
+  }
+
+  /** @return estimate of the count of distinct words added */
+  [[nodiscard]] double estimate() const noexcept {
+    const auto m = static_cast<double>(registers.size());
+    double sum = 0;
+    std::size_t zeros = 0;
+    for(const auto reg : registers) {
+      sum += std::ldexp(1.0, -reg);
+      zeros += reg == 0;
+    }
+    const double alpha = 0.7213 / (1 + 1.079 / m);
+    const auto raw = alpha * m * m / sum;
+    if (raw <= 2.5 * m && zeros > 0) { return m * std::log(m / static_cast<double>(zeros)); }
+    return raw;
+  }
+
+  /** @return the relative standard error of the estimate */
+  [[nodiscard]] double standard_error() const noexcept {
+    return 1.04 / std::sqrt(static_cast<double>(registers.size()));
+  }
+
+  [[nodiscard]] std::size_t register_count() const noexcept { return registers.size(); }
+};
+
+/**
+ * Cheap pre-pass estimate of the vocabulary size of an input, so
+ * that the count table can be presized for it. Only a memory mapped
+ * input can be read twice, so for any other input there's no estimate.
+ *
+ * The distinct words of (up to) the first sample_bytes of the input are
+ * estimated with a HyperLogLog sketch, at half of the sample and at all
+ * of it. When the sample is not the whole input the vocabulary size is
+ * extrapolated by Heaps' law, V(n) = K n^b, with the exponent b fitted
+ * to the growth of the vocabulary between the two estimates.
+ *
+ * @param fd file descriptor of the input
+ * @param sample_bytes size of the sample of the input
+ * @return the estimated vocabulary size, or zero if the input can't
+ * be sampled
+ */
+inline std::size_t estimate_vocabulary(int fd, std::size_t sample_bytes = 16 * 1024 * 1024) {
+  input_source source{fd};
+  struct stat st{};
+  if (!source.is_mapped() || ::fstat(fd, &st) == -1) { return 0; }
+  // (the input is what's left of the file from the current offset of the file descriptor)
+  const auto input_size = static_cast<std::size_t>(st.st_size - ::lseek(fd, 0, SEEK_CUR));
+  hyperloglog sketch{};
+  word_splitter splitter{};
+  std::vector<std::string_view> words{};
+  double half_estimate = 0;
+  std::size_t half_bytes = 0;
+  while (source.bytes_read() < sample_bytes) {
+    const auto chunk = source.next_chunk();
+    if (!chunk) { break; }
+    splitter.split(*chunk, words);
+    std::ranges::for_each(words, [&sketch](const std::string_view word) { sketch.add(word); });
+    if (half_bytes == 0 && source.bytes_read() >= sample_bytes / 2) {
+      half_estimate = sketch.estimate();
+      half_bytes = source.bytes_read();
+    }
+  }
+  const auto estimate = sketch.estimate();
+  const auto sampled = source.bytes_read();
+  if (sampled >= input_size || half_bytes == 0 || half_bytes == sampled || half_estimate < 1) {
+    return static_cast<std::size_t>(estimate);
+  }
+  const auto b = std::clamp(std::log(estimate / half_estimate) /
+                            std::log(static_cast<double>(sampled) / static_cast<double>(half_bytes)), 0.0, 1.0);
+  return static_cast<std::size_t>(estimate * std::pow(static_cast<double>(input_size) / static_cast<double>(sampled), b));
+}
+
+#endif //HYPERLOGLOG_H
@@ -0,0 +1,174 @@
+/* input_source.h
+
+Copyright 2023 Roger D. Voss
+
+Created by github user roger-dv on 04/08/2023.
+
+Licensed under the MIT License - refer to LICENSE project document.
+
+*/
+#ifndef INPUT_SOURCE_H
+#define INPUT_SOURCE_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <system_error>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Whitespace as classified by std::isspace() in the "C" locale,
+ * which is what operator>>(std::istream&, std::string&) splits
+ * text tokens on when reading std::cin.
+ *
+ * @param c character to classify
+ * @return true if c is a whitespace character
+ */
+constexpr bool is_space_char(const char c) noexcept {
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+/**
+ * Supplies the bytes of an input file descriptor as a sequence
+ * of chunks. A chunk always ends on a whitespace boundary (or at
+ * end of input) so a text token is never split across two chunks.
+ *
+ * When the file descriptor refers to a regular file it is memory
+ * mapped and chunks are windows into the mapping (no copying) -
+ * from the current offset of the file descriptor on, just as the
+ * input would be read.
+ * Otherwise (pipes, ttys, etc.) the input is pulled in with large
+ * block read() calls into a reusable buffer; the buffer grows only
+ * if a single token is larger than the buffer.
+ *
+ * A chunk returned by next_chunk() remains valid until the next
+ * call of next_chunk().
+ */
+class input_source {
+private:
+  static constexpr std::size_t read_block_size = 1024 * 1024;
+  static constexpr std::size_t map_window_size = 1024 * 1024;
+
+  int fd;
+  // memory mapped mode
+  const char *map_addr = nullptr;
+  std::size_t map_size = 0;
+  std::size_t map_pos = 0;
+  // block read mode
+  std::unique_ptr<char[]> buf{};
+  std::size_t buf_capacity = 0;
+  std::size_t buf_filled = 0;
+  std::size_t carry_begin = 0;
+  bool at_eof = false;
+  std::size_t bytes_supplied = 0;
+
+  std::string_view next_mapped_chunk() noexcept {
+    const auto begin = map_pos;
+    auto end = map_size - begin > map_window_size ? begin + map_window_size : map_size;
+    while (end < map_size && !is_space_char(map_addr[end - 1])) { end++; }
+    map_pos = end;
+    return {map_addr + begin, end - begin};
+  }
+
+  std::optional<std::string_view> next_read_chunk() {
+    // shift any partial token left over from the prior chunk to the front of the buffer
+    if (carry_begin > 0) {
+      std::copy(buf.get() + carry_begin, buf.get() + buf_filled, buf.get());
+      buf_filled -= carry_begin;
+      carry_begin = 0;
+    }
+    for(;;) {
+      if (at_eof) {
+        if (buf_filled == 0) { return std::nullopt; }
+        carry_begin = buf_filled;
+        return std::string_view{buf.get(), buf_filled};
+      }
+      if (buf_filled == buf_capacity) {
+        // a single token fills the whole buffer - grow it
+        auto bigger = std::make_unique<char[]>(buf_capacity * 2);
+        std::copy(buf.get(), buf.get() + buf_filled, bigger.get());
+        buf = std::move(bigger);
+        buf_capacity *= 2;
+      }
+      const auto prior_filled = buf_filled;
+      const auto n = ::read(fd, buf.get() + buf_filled, buf_capacity - buf_filled);
+      if (n < 0) {
+        if (errno == EINTR) { continue; }
+        throw std::system_error(errno, std::generic_category(), "read() of input failed");
+      }
+      if (n == 0) {
+        at_eof = true;
+        continue;
+      }
+      buf_filled += static_cast<std::size_t>(n);
+      for(auto i = buf_filled; i > prior_filled; i--) {
+        if (is_space_char(buf[i - 1])) {
+          carry_begin = i;
+          return std::string_view{buf.get(), i};
+        }
+      }
+    }
+  }
+
+public:
+  explicit input_source(int input_fd) : fd(input_fd) {
+    struct stat st{};
+    // the input starts from the current offset of the file descriptor (some of the file may
+    // already have been read) - the mapping starts from the page holding that offset
+    const auto offset = ::lseek(fd, 0, SEEK_CUR);
+    if (offset >= 0 && ::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > offset) {
+      const auto page_offset = offset & ~static_cast<off_t>(::sysconf(_SC_PAGESIZE) - 1);
+      const auto size = static_cast<std::size_t>(st.st_size - page_offset);
+      void *const addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, page_offset);
+      if (addr != MAP_FAILED) {
+        ::madvise(addr, size, MADV_SEQUENTIAL);
+        map_addr = static_cast<const char*>(addr);
+        map_size = size;
+        map_pos = static_cast<std::size_t>(offset - page_offset);
+        return;
+      }
+    }
+    // not a regular file (or could not be mapped) so fall back to block reads
+    buf = std::make_unique<char[]>(read_block_size);
+    buf_capacity = read_block_size;
+  }
+  input_source() = delete;
+  input_source(const input_source&) = delete;
+  input_source(input_source&&) = delete;
+  ~input_source() {
+    if (map_addr != nullptr) {
+      ::munmap(const_cast<char*>(map_addr), map_size);
+    }
+  }
+  input_source&operator =(const input_source&) = delete;
+  input_source&operator =(input_source&&) = delete;
+
+  [[nodiscard]] bool is_mapped() const noexcept { return map_addr != nullptr; }
+
+  /**
+   * Obtains the next chunk of input.
+   *
+   * @return chunk of input text that ends on a whitespace
+   * boundary, or std::nullopt when the input is exhausted
+   */
+  std::optional<std::string_view> next_chunk() {
+    std::optional<std::string_view> chunk{};
+    if (map_addr != nullptr) {
+      if (map_pos < map_size) { chunk = next_mapped_chunk(); }
+    } else {
+      chunk = next_read_chunk();
+    }
+    if (chunk) { bytes_supplied += chunk->size(); }
+    return chunk;
+  }
+
+  /** @return count of the bytes of input supplied in chunks so far */
+  [[nodiscard]] std::size_t bytes_read() const noexcept { return bytes_supplied; }
+};
+
+#endif //INPUT_SOURCE_H
@@ -9,243 +9,186 @@ Licensed under the MIT License - refer to LICENSE project document.
 */
 #include <ranges>
 #include <algorithm>
-#include <unordered_map>
 #include <vector>
-#include <set>
-#include <iostream>
-
-/**
- * Counts the occurrence of string tokens in the collection
- * passed as the input.
- *
- * @tparam C input collection type of string tokens (must
- * support ranges)
- * @tparam T string type of a collection element (must
- * be possible to construct std::string from T)
- * @param collection an input collection of string tokens
- * @return unordered map where key is a string token from
- * the input and its associated value is count of its
- * occurrence in the collection.
- */
-template <typename C, typename T = typename C::value_type>
-    requires std::ranges::range<C> && std::constructible_from<std::string, T>
-auto count_occurrences(const C &collection) {
-  std::unordered_map<std::string, unsigned int> counts{};
-  counts.reserve(collection.size() * 5 / 3);
-  std::ranges::for_each(collection, [&counts](const T& elem) {
-    unsigned int new_count = 1;
-    if (auto search = counts.find(elem); search != counts.end()) {
-      const auto current_count = search->second;
-      new_count += current_count;
-    }
-    counts[elem] = new_count;
-  });
-  return counts;
-}
+#include "tokenizer.h"
+#include "collection_append.h"
+#include "count_occurrences.h"
+#include "parallel_count.h"
+#include "file_count.h"
+#include "pipeline_count.h"
+#include "options.h"
+#include "ranking.h"
+#include "print_collection.h"
+#include "diagnostics.h"
+#include "stats.h"
+#include "heavy_hitters.h"
+#include "hyperloglog.h"
+
+int main(int argc, char *argv[]) {
+  const auto opts = parse_options(argc, argv);
+  if (!opts) { return EXIT_FAILURE; }
+  phase_timer timer{opts->perf};
+
+  // a failed write of the output (such as to a full disk) is reported the same as a failure of
+  // the input - except for a closed pipe, where the reader of the output just went away
+  auto const output_failed = [argv](const std::system_error &e) {
+    if (e.code() != std::errc::broken_pipe) { fprintf(stderr, "%s: %s\n", argv[0], e.what()); }
+    return EXIT_FAILURE;
+  };
 
-template<typename C, typename E = typename C::value_type>
-concept AppendableCollection = requires(C c) {
-  { &c } -> std::input_iterator;
-  requires std::move_constructible<E>;
-  { c.emplace_back(std::move(E{})) };
-};
-
-template<typename R, typename T>
-concept MovableRangeElement = requires(R r) {
-  std::ranges::begin(r);
-  std::ranges::end(r);
-  { *(r.begin()) } -> std::same_as<T>;
-  requires std::move_constructible<T>;
-};
-
-/**
- * This template class is just an exercise in writing
- * a class that has some behaviors of a collection and
- * how to use concepts to constrain aspects of that.
- *
- * An instantiation of this template will wrap the
- * actual underlying collection.
- *
- * IOW, in the word counting code below, this class
- * could be dispensed with and the underlying collection
- * used directly instead. Again, is for learning.
- *
- * @tparam C type of the collection being wrapped
- * @tparam T type of a collection element
- * @tparam CIter constant iterator type
- * @tparam Iter non constant iterator type
- */
-template <typename C,
-          typename T = typename C::value_type,
-          typename CIter = typename C::const_iterator,
-          typename Iter = typename C::iterator>
-  requires AppendableCollection<C>
-class collection_append {
-private: C &collection;
-public:
-  using value_type [[maybe_unused]] = T;
-  using const_iterator [[maybe_unused]] = CIter;
-  using iterator = Iter;
-  explicit collection_append(C &coll) : collection(coll) {}
-  collection_append() = delete;
-  collection_append(const collection_append&) = delete;
-  collection_append(collection_append&&) = delete;
-  ~collection_append() = default;
-  collection_append&operator =(const collection_append&) = delete;
-  collection_append&operator =(collection_append&&) = delete;
-
-  collection_append& append(T &&item) {
-    this->collection.emplace_back(item);
-    return *this;
-  }
+  // the bytes of every distinct word - the keys of the counts map, which the count pairs
+  // then refer to - are carved out of large slabs of memory that are released all at once at exit
+  std::pmr::monotonic_buffer_resource word_storage{1024 * 1024};
 
-  template<typename R>
-    requires MovableRangeElement<R, T>
-  void append_range(R &&rng) {
-    std::ranges::for_each(rng, [this](auto &&e){ collection.emplace_back(e); });
-  }
+  // the tuple pair pass as input is flipped which is returned as output
+  // (the word of the returned pair refers to the word of the count table entry - is not copied)
+  auto const flip_pair = [](const auto &entry) {
+    return count_pair_t{entry.second, std::string_view{entry.first}};
+  };
 
-  inline iterator begin() noexcept {
-    return this->collection.begin();
+  // process input from stdin, which will be a stream of text tokens.
+  // (stdin is memory mapped when it is a regular file, otherwise is read in large blocks)
+  // Text tokens are filtered to alpha text words and C preprocessor directives that begin
+  // with '#' (alpha text string runs also permitted to have hyphen '-' and underscore '_'
+  // characters) and made lower case - a SIMD classifier does all that in a single pass.
+  input_source stdin_source{STDIN_FILENO};
+  auto rng0 = word_view{stdin_source};
+
+  // cardinality mode - just the estimated number of distinct words, in a few KiB of memory
+  if (opts->distinct) {
+    hyperloglog sketch{};
+    std::ranges::for_each(rng0, [&sketch](const std::string_view word) { sketch.add(word); });
+    try {
+      print_distinct_estimate(sketch, opts->diagnostics);
+    } catch (const std::system_error &e) {
+      return output_failed(e);
+    }
+    return EXIT_SUCCESS;
   }
 
-  inline iterator end() noexcept {
-    return this->collection.end();
+  // approximate mode - the words stream through a fixed number of Space-Saving counters, so
+  // memory use is bounded however large the vocabulary (the counts then come with error bounds)
+  if (opts->heavy_hitters > 0) {
+    space_saving sketch{opts->heavy_hitters};
+    std::ranges::for_each(rng0, [&sketch](const std::string_view word) { count_word(sketch, word); });
+    std::vector<count_pair_t> count_pairs{};
+    count_pairs.reserve(sketch.monitored().size());
+    std::ranges::transform(sketch.monitored(), std::back_inserter(count_pairs),
+                           [](const auto &c) { return count_pair_t{c.count, c.word}; });
+    rank_count_pairs(count_pairs, opts->top_k);
+    try {
+      print_collection(count_pairs);
+      if (opts->diagnostics == diagnostics_mode::text) {
+        print_text_heavy_hitters(sketch, count_pairs);
+      } else if (opts->diagnostics == diagnostics_mode::json) {
+        print_json_heavy_hitters(sketch, count_pairs);
+      }
+    } catch (const std::system_error &e) {
+      return output_failed(e);
+    }
+    return EXIT_SUCCESS;
   }
-};
-
-using count_pair_t = std::pair<unsigned int, std::string>;
-
-/**
- * For a collection passed as input, prints out its
- * elements to stdout. The collection element is a
- * tuple consisting of a paired integer and string.
- * Each element is printed on a single line.
- *
- * @tparam C input collection type (must support ranges)
- * @tparam E collection element type - must be a tuple
- * consisting of a paired unsigned integer and string.
- * @param coll input collection
- */
-template<typename C, typename E = typename C::value_type>
-  requires std::ranges::range<C> && std::same_as<E, count_pair_t>
-void print_collection(const C &coll) {
-  std::ranges::for_each(coll, [](const E &elem){ std::cout << elem.first << ": " << elem.second << '\n'; });
-}
 
-int main() {
-  // predicate filters for alpha text words and C preprocessor directives that begin with '#'
-  // (alpha text string runs also permitted to have hyphen '-' and underscore '_' characters)
-  auto const is_alpha_word = [](const std::string_view word) {
-    const auto first_char = word.front();
-    using elm_t = decltype(first_char);
-    auto const other_allowed = first_char == '#' ?
-        [](elm_t c) { return false; } : [](elm_t c) { return c == '-' || c == '_'; };
-    auto subwrd = word.substr(1);
-    for(const auto c : subwrd) {
-      if (std::isalpha(c) == 0 && !other_allowed(c)) { return false; }
-    }
-    return !(std::isalpha(first_char) == 0 && first_char != '#' && first_char != '_');
-  };
-  // duplicates the input string, makes it lowercase, and returns that as output
-  auto const to_lower_case = [](const std::string_view word) {
-    std::string word_copy{word};
-    std::transform(word_copy.begin(), word_copy.end(), word_copy.begin(), ::tolower);
-    return word_copy;
-  };
-  // the tuple pair pass as input is flipped which is returned as output
-  auto const flip_pair = [](const std::pair<std::string, unsigned int> &entry) {
-    return std::make_pair(entry.second, entry.first);
-  };
-  // two tuple pairs as input are compared on their word count value
-  auto const compare_counts = [](const count_pair_t &x, const count_pair_t &y) {
-    return x.first > y.first;
+  // rng0 range will now be lazy evaluated against the stdin input source as
+  // its words are counted (one pass, the words are never collected up front);
+  // a std::string is only materialized for a distinct word when it's first counted
+  // (with -j the input chunks are instead counted across worker threads and merged, or
+  // with --shared-table counted into one table shared by the workers; with --pipeline they
+  // flow through tokenizer threads to the counter thread owning each word; and files named
+  // on the command line are counted a file at a time per worker)
+  token_tally tally{};
+  std::size_t bytes_read = 0;
+  auto const input_failed = [argv](const std::system_error &e) {
+    fprintf(stderr, "%s: %s\n", argv[0], e.what());
+    return EXIT_FAILURE;
   };
-  // two tuple pairs as input are lexically compared on their word value
-  auto const compare_words = [](const count_pair_t &x, const count_pair_t &y) {
-    return x.second.compare(y.second) < 0;
+  auto const count_input = [&]() -> count_table_t {
+    try {
+      if (!opts->paths.empty()) {
+        return count_files(collect_input_files(opts->paths), opts->threads, &tally, &bytes_read);
+      }
+      if (opts->pipeline) {
+        const auto n_tokenizers = std::max(1u, opts->threads / 2);
+        const auto n_counters = std::max(1u, opts->threads - n_tokenizers);
+        auto counts = count_occurrences_pipelined(stdin_source, n_tokenizers, n_counters, &tally);
+        bytes_read = stdin_source.bytes_read();
+        return counts;
+      }
+      if (opts->threads > 1) {
+        auto counts = count_occurrences_parallel(stdin_source, opts->threads, &tally);
+        bytes_read = stdin_source.bytes_read();
+        return counts;
+      }
+      // (a pre-pass over a sample of the input can estimate the vocabulary to presize for)
+      const auto expected_words = opts->presize ? estimate_vocabulary(STDIN_FILENO) : 0;
+      auto counts = count_occurrences(rng0, &word_storage, expected_words);
+      tally = rng0.tally();
+      bytes_read = stdin_source.bytes_read();
+      return counts;
+    } catch (const std::system_error &e) {
+      std::exit(input_failed(e));
+    }
   };
-  // two tuple pairs as input are compared on their word count values and returns true when they're equal
-  auto const found_pred = [](const count_pair_t &arg1, const count_pair_t &arg2) { return arg1.first == arg2.first; };
 
+  // the counts are ranked and printed from whichever type of table they were counted into
+  auto const rank_and_print = [&](const auto &counts_map) {
+    // the map of word counts, where map key is the word and its value its count,
+    // is transferred to a vector of tuple pair where the first tuple item is the
+    // word count and the second tuple item is the word; the vector is then sorted
+    std::vector<count_pair_t> count_pairs{};
+    count_pairs.reserve(counts_map.size());
+    collection_append add_count_pairs{count_pairs}; // wrap vector with a custom appender (wrapper class is just for learning)
+    auto rng1 = counts_map | std::views::transform(flip_pair);
+    // rng1 range will now be lazy evaluated as its elements are move appended to count_pairs
+    add_count_pairs.append_range(rng1);
+    timer.lap("append");
+    // sort by word count descending and then by word, as one composite ordering
+    // (or in top-K mode retain only the K highest ranked pairs) - on the -j threads
+    rank_count_pairs(count_pairs, opts->top_k, opts->threads);
+    timer.lap("rank");
+
+    try {
+      // diagnostics (to stderr) - they're derived from the ranked pairs and the
+      // vocabulary of the counts map, so the input tokens are never revisited
+      if (opts->diagnostics == diagnostics_mode::text) {
+        print_text_count_set(distinct_counts(count_pairs));
+      }
+      timer.lap("diagnostics");
 
-  std::vector<std::string> words;
-  words.reserve(8 * 1024); // preallocate for 8K vector items (vector automatically expands it that is exceeded)
-  collection_append add_words{words}; // wrap vector with a custom appender (wrapper class is just for learning)
+      // main output (to stdout)
+      print_collection(count_pairs);
+      timer.lap("print");
 
-  // process input from stdin, which will be a stream of text tokens.
-  // Text tokens are filtered to alphabetic only and made lower case.
-  auto rng0 = std::ranges::istream_view<std::string>{std::cin}
-              | std::views::filter(is_alpha_word)
-              | std::views::transform(to_lower_case);
-
-  // rng0 range will now be lazy evaluated against the cin input stream
-  add_words.append_range(rng0);
-
-  // words collection holds the alpha text tokens read in from stdin;
-  // now will count their occurrence in the collection:
-  const auto counts_map = count_occurrences(words);
-
-  // the map of word counts, where map key is the word and its value its count,
-  // is transferred to a vector of tuple pair where the first tuple item is the
-  // word count and the second tuple item is the word; the vector is then sorted
-  std::vector<count_pair_t> count_pairs{};
-  count_pairs.reserve(counts_map.size());
-  std::set<unsigned int> just_counts{};
-  auto const collect_just_counts = [counts=&just_counts]
-      (const count_pair_t &item) { counts->emplace(item.first); return true; };
-  auto rng1 = counts_map
-              | std::views::transform(flip_pair)
-              | std::views::filter(collect_just_counts);
-  // rng1 range will now be lazy evaluated as its elements are move appended to count_pairs
-  std::ranges::for_each(rng1, [&count_pairs](auto &&count_pair){ count_pairs.emplace_back(count_pair); });
-  // sort by word count
-  std::ranges::sort(count_pairs, compare_counts);
-
-  // make order of word counts descend from largest to smallest
-  // (retain the returned range to iterate against)
-  auto just_counts_rng = std::views::reverse(just_counts);
-
-  // for each unique count of words find the set of words that have that count and sort that subset range
-  std::array<count_pair_t, 1> the_search_item{ count_pair_t{ 0, std::string{} } };
-  auto current = count_pairs.begin();
-  const auto very_end = count_pairs.end();
-  int check_count = 0, sub_rng_count = 0;
-  for(const auto n : just_counts_rng) {
-    check_count++;
-    the_search_item[0].first = n;
-    current = std::find_first_of(current, very_end, the_search_item.begin(), the_search_item.end(), found_pred);
-    if (current != very_end) {
-      auto sub_rng_end = std::find_end(current, very_end, the_search_item.begin(), the_search_item.end(), found_pred);
-      auto sub_rng = std::ranges::subrange(current, sub_rng_end != very_end ? sub_rng_end + 1 : sub_rng_end);
-      std::ranges::sort(sub_rng, compare_words);
-      if (sub_rng_end != very_end) {
-        current = sub_rng_end;
+      if (opts->diagnostics == diagnostics_mode::text) {
+        print_text_counted_words(sorted_vocabulary(counts_map));
+      } else if (opts->diagnostics == diagnostics_mode::json) {
+        print_json_diagnostics(distinct_counts(count_pairs), sorted_vocabulary(counts_map));
       }
-      sub_rng_count++;
-    } else {
-      break;
+      timer.lap("diagnostics");
+    } catch (const std::system_error &e) {
+      return output_failed(e);
     }
-  }
-
-  // debug (to stderr)
-  std::cerr << "\nDEBUG: word-count-set: { ";
-  std::ranges::for_each(just_counts_rng, [](const auto &n) { std::cerr << n << ' '; });
-  std::cerr << "}\n";
-
-  fprintf(stderr, "\nDEBUG: word-count-set size: %lu, check count: %d, sub-range count: %d\n\n",
-          just_counts.size(), check_count, sub_rng_count);
 
+    if (opts->stats) {
+      print_stats_json(timer, bytes_read, tally, counts_map, opts->threads);
+    }
+    return EXIT_SUCCESS;
+  };
 
-  // main output (to stdout)
-  print_collection(count_pairs);
-
-
-  // reduce to sorted, unique set of words that were counted
-  std::ranges::sort(words);
-  auto rng2 = std::ranges::unique(words);
-  words.erase(rng2.begin(), rng2.end());
-
-  std::cerr << "\nDEBUG: counted words:\n";
-  std::ranges::copy(words, std::ostream_iterator<std::string>(std::cerr, "\n"));
-}
\ No newline at end of file
+  if (opts->shared_table && opts->threads > 1) {
+    // the shared table grows by chaining levels rather than by rehashing, so its
+    // first level is presized by a pre-pass over a sample of the input (when mapped)
+    concurrent_count_table counts_map{estimate_vocabulary(STDIN_FILENO)};
+    try {
+      count_occurrences_shared(stdin_source, counts_map, opts->threads, &tally);
+    } catch (const std::system_error &e) {
+      return input_failed(e);
+    }
+    bytes_read = stdin_source.bytes_read();
+    timer.lap("count");
+    return rank_and_print(counts_map);
+  }
+  const auto counts_map = count_input();
+  timer.lap("count");
+  return rank_and_print(counts_map);
+}
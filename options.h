@@ -0,0 +1,236 @@
+/* options.h
+
+Copyright 2023 Roger D. Voss
+
+Created by github user roger-dv on 04/08/2023.
+
+Licensed under the MIT License - refer to LICENSE project document.
+
+*/
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <getopt.h>
+#include <optional>
+#include <string_view>
+#include <vector>
+#include "diagnostics.h"
+
+/**
+ * The command line options of the program.
+ */
+struct program_options {
+  std::size_t top_k = 0; // when non-zero only the top_k most frequent words are output
+  unsigned int threads = 1; // count of threads that the input is counted on
+  diagnostics_mode diagnostics = diagnostics_mode::text; // what is reported to stderr
+  bool stats = false; // when true the run statistics are written to stderr as JSON
+  bool perf = false; // when true the statistics include the hardware performance counters
+  bool pipeline = false; // when true stdin is counted by a pipeline of reader, tokenizer and counter threads
+  bool shared_table = false; // when true the -j threads count into one shared concurrent table
+  std::size_t heavy_hitters = 0; // when non-zero stdin is counted approximately in this many counters
+  bool distinct = false; // when true only the number of distinct words of stdin is estimated
+  bool presize = false; // when true the count table is presized by a sampling pre-pass over stdin
+  std::vector<std::filesystem::path> paths{}; // input files and directories (stdin when there are none)
+};
+
+// getopt_long() value of the long options that have no short form
+constexpr int stats_option = 256;
+constexpr int perf_option = 257;
+constexpr int pipeline_option = 258;
+constexpr int shared_table_option = 259;
+constexpr int heavy_hitters_option = 260;
+constexpr int distinct_option = 261;
+constexpr int presize_option = 262;
+
+inline void print_usage(const char *program) {
+  fprintf(stderr,
+          "usage: %s [options] [file | directory]...\n"
+          "  words are counted in the files (directories are walked recursively),\n"
+          "  or in stdin when no files are given\n"
+          "  -k, --top N   output only the N most frequent words\n"
+          "  -j, --jobs N  count the input on N threads\n"
+          "      --pipeline\n"
+          "                count stdin in pipelined stages: a reader, then the N threads\n"
+          "                split between tokenizers and counters\n"
+          "      --shared-table\n"
+          "                the -j threads count stdin into one shared lock-free table\n"
+          "                (instead of a table each, merged at the end); with -j 1 there\n"
+          "                is only the one table\n"
+          "      --heavy-hitters N\n"
+          "                approximate counts of stdin in fixed memory - only the N most\n"
+          "                frequent words are monitored (Space-Saving, ~64 bytes a word,\n"
+          "                N up to 16777216); the error bound of each count is in the\n"
+          "                diagnostics\n"
+          "      --distinct\n"
+          "                only estimate the number of distinct words of stdin (HyperLogLog)\n"
+          "      --presize\n"
+          "                presize the count table from a HyperLogLog estimate of the\n"
+          "                vocabulary of a sample of stdin (when it's a regular file); for\n"
+          "                a count on one thread (--shared-table is always presized)\n"
+          "  -q, --quiet   no diagnostics (same as --diagnostics none)\n"
+          "  -d, --diagnostics MODE\n"
+          "                diagnostics written to stderr: none, text (default) or json\n"
+          "      --stats   write the run statistics (timings, counters) to stderr as JSON\n"
+          "      --perf    --stats plus hardware performance counters per phase (perf_event_open)\n"
+          "  -h, --help    print this usage\n",
+          program);
+}
+
+/**
+ * Parses an option argument that must be a positive integer.
+ *
+ * @param arg text of the option argument
+ * @return the integer value, or std::nullopt if arg is not a
+ * positive integer
+ */
+inline std::optional<std::size_t> parse_positive(const std::string_view arg) {
+  std::size_t value = 0;
+  const auto [end, ec] = std::from_chars(arg.data(), arg.data() + arg.size(), value);
+  if (ec != std::errc{} || end != arg.data() + arg.size() || value == 0) { return std::nullopt; }
+  return value;
+}
+
+/**
+ * Parses the command line. On a command line error the usage is
+ * printed to stderr. The arguments that follow the options are the
+ * input files and directories.
+ *
+ * @param argc count of command line arguments
+ * @param argv command line arguments
+ * @return the parsed options, or std::nullopt if the command
+ * line is in error (when help is requested the program exits)
+ */
+inline std::optional<program_options> parse_options(int argc, char *argv[]) {
+  static const option long_options[] = {
+      {"top",  required_argument, nullptr, 'k'},
+      {"jobs", required_argument, nullptr, 'j'},
+      {"quiet", no_argument,      nullptr, 'q'},
+      {"diagnostics", required_argument, nullptr, 'd'},
+      {"stats", no_argument,      nullptr, stats_option},
+      {"perf", no_argument,       nullptr, perf_option},
+      {"pipeline", no_argument,   nullptr, pipeline_option},
+      {"shared-table", no_argument, nullptr, shared_table_option},
+      {"heavy-hitters", required_argument, nullptr, heavy_hitters_option},
+      {"distinct", no_argument,   nullptr, distinct_option},
+      {"presize", no_argument,    nullptr, presize_option},
+      {"help", no_argument,       nullptr, 'h'},
+      {nullptr, 0,                nullptr, 0}
+  };
+  program_options opts{};
+  int c;
+  while ((c = getopt_long(argc, argv, "k:j:qd:h", long_options, nullptr)) != -1) {
+    switch (c) {
+      case 'k':
+        if (auto k = parse_positive(optarg)) {
+          opts.top_k = *k;
+          break;
+        }
+        fprintf(stderr, "%s: invalid count for -k: %s\n", argv[0], optarg);
+        print_usage(argv[0]);
+        return std::nullopt;
+      case 'j':
+        if (auto j = parse_positive(optarg); j && *j <= 1024) {
+          opts.threads = static_cast<unsigned int>(*j);
+          break;
+        }
+        fprintf(stderr, "%s: invalid thread count for -j: %s\n", argv[0], optarg);
+        print_usage(argv[0]);
+        return std::nullopt;
+      case 'q':
+        opts.diagnostics = diagnostics_mode::none;
+        break;
+      case 'd':
+        if (const std::string_view mode{optarg}; mode == "none") {
+          opts.diagnostics = diagnostics_mode::none;
+        } else if (mode == "text") {
+          opts.diagnostics = diagnostics_mode::text;
+        } else if (mode == "json") {
+          opts.diagnostics = diagnostics_mode::json;
+        } else {
+          fprintf(stderr, "%s: invalid diagnostics mode: %s\n", argv[0], optarg);
+          print_usage(argv[0]);
+          return std::nullopt;
+        }
+        break;
+      case stats_option:
+        opts.stats = true;
+        break;
+      case perf_option:
+        opts.stats = opts.perf = true;
+        break;
+      case pipeline_option:
+        opts.pipeline = true;
+        break;
+      case shared_table_option:
+        opts.shared_table = true;
+        break;
+      case heavy_hitters_option:
+        // (the counters are all allocated up front, so their number is capped at what can be fixed in memory)
+        if (auto n = parse_positive(optarg); n && *n <= space_saving::max_counters) {
+          opts.heavy_hitters = *n;
+          break;
+        }
+        fprintf(stderr, "%s: invalid counter count for --heavy-hitters (1 to %zu): %s\n", argv[0],
+                space_saving::max_counters, optarg);
+        print_usage(argv[0]);
+        return std::nullopt;
+      case distinct_option:
+        opts.distinct = true;
+        break;
+      case presize_option:
+        opts.presize = true;
+        break;
+      case 'h':
+        print_usage(argv[0]);
+        std::exit(EXIT_SUCCESS);
+      default:
+        print_usage(argv[0]);
+        return std::nullopt;
+    }
+  }
+  opts.paths.assign(argv + optind, argv + argc);
+  if ((opts.heavy_hitters > 0 || opts.distinct) && !opts.paths.empty()) {
+    fprintf(stderr, "%s: --heavy-hitters and --distinct count the stream of stdin only\n", argv[0]);
+    print_usage(argv[0]);
+    return std::nullopt;
+  }
+  // (the exact counting modes would otherwise fall back silently - files are counted a file at a time per worker)
+  if ((opts.pipeline || opts.shared_table) && !opts.paths.empty()) {
+    fprintf(stderr, "%s: --pipeline and --shared-table count the stream of stdin only\n", argv[0]);
+    print_usage(argv[0]);
+    return std::nullopt;
+  }
+  if (opts.pipeline && opts.shared_table) {
+    fprintf(stderr, "%s: --pipeline and --shared-table are exclusive\n", argv[0]);
+    print_usage(argv[0]);
+    return std::nullopt;
+  }
+  // (the sketches are single-threaded and keep no run statistics)
+  if ((opts.heavy_hitters > 0 || opts.distinct)
+      && (opts.threads > 1 || opts.pipeline || opts.shared_table || opts.stats)) {
+    fprintf(stderr, "%s: --heavy-hitters and --distinct take none of -j, --pipeline, --shared-table, --stats or --perf\n",
+            argv[0]);
+    print_usage(argv[0]);
+    return std::nullopt;
+  }
+  if (opts.distinct && (opts.heavy_hitters > 0 || opts.top_k > 0)) {
+    fprintf(stderr, "%s: --distinct outputs only the estimate, so takes neither --heavy-hitters nor -k\n", argv[0]);
+    print_usage(argv[0]);
+    return std::nullopt;
+  }
+  // (only the one table of a single threaded count is presized - the shared table always is)
+  if (opts.presize && (!opts.paths.empty() || opts.pipeline || opts.heavy_hitters > 0 || opts.distinct
+                       || (opts.threads > 1 && !opts.shared_table))) {
+    fprintf(stderr, "%s: --presize presizes the table of a count of stdin on one thread or with --shared-table\n",
+            argv[0]);
+    print_usage(argv[0]);
+    return std::nullopt;
+  }
+  return opts;
+}
+
+#endif //OPTIONS_H
@@ -0,0 +1,107 @@
+/* output_sink.h
+
+Copyright 2023 Roger D. Voss
+
+Created by github user roger-dv on 04/08/2023.
+
+Licensed under the MIT License - refer to LICENSE project document.
+
+*/
+#ifndef OUTPUT_SINK_H
+#define OUTPUT_SINK_H
+
+#include <cerrno>
+#include <charconv>
+#include <concepts>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <system_error>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/**
+ * Buffered writer of text to a file descriptor. Text is gathered
+ * into one large reusable buffer and handed to the file descriptor
+ * with write() when the buffer fills - bypassing the iostream
+ * machinery (no stdio synchronization, no locale, no allocation).
+ * A string too large to fit in what remains of the buffer is
+ * written out together with the buffered text by a single writev(),
+ * rather than being copied.
+ *
+ * Integers are formatted with std::to_chars.
+ */
+class output_sink {
+private:
+  static constexpr std::size_t buffer_size = 256 * 1024;
+
+  int fd;
+  std::unique_ptr<char[]> buf = std::make_unique<char[]>(buffer_size);
+  std::size_t used = 0;
+
+  void write_all(iovec *iov, int iov_count) {
+    while (iov_count > 0) {
+      const auto n = ::writev(fd, iov, iov_count);
+      if (n < 0) {
+        if (errno == EINTR) { continue; }
+        throw std::system_error(errno, std::generic_category(), "write() of output failed");
+      }
+      // step past what was written (may be a partial write)
+      auto written = static_cast<std::size_t>(n);
+      while (iov_count > 0 && written >= iov->iov_len) {
+        written -= iov->iov_len;
+        iov++;
+        iov_count--;
+      }
+      if (iov_count > 0) {
+        iov->iov_base = static_cast<char*>(iov->iov_base) + written;
+        iov->iov_len -= written;
+      }
+    }
+  }
+
+public:
+  explicit output_sink(int output_fd) : fd(output_fd) {}
+  output_sink() = delete;
+  output_sink(const output_sink&) = delete;
+  output_sink(output_sink&&) = delete;
+  ~output_sink() = default; // any buffered text must be flushed explicitly
+  output_sink&operator =(const output_sink&) = delete;
+  output_sink&operator =(output_sink&&) = delete;
+
+  output_sink& operator<<(const std::string_view str) {
+    if (str.size() <= buffer_size - used) {
+      std::memcpy(buf.get() + used, str.data(), str.size());
+      used += str.size();
+    } else {
+      iovec iov[2] = {{buf.get(), used}, {const_cast<char*>(str.data()), str.size()}};
+      write_all(iov, 2);
+      used = 0;
+    }
+    return *this;
+  }
+
+  output_sink& operator<<(const char c) {
+    if (used == buffer_size) { flush(); }
+    buf[used++] = c;
+    return *this;
+  }
+
+  template<std::unsigned_integral T>
+  output_sink& operator<<(const T n) {
+    char digits[24];
+    const auto result = std::to_chars(std::begin(digits), std::end(digits), n);
+    return *this << std::string_view{digits, static_cast<std::size_t>(result.ptr - digits)};
+  }
+
+  /** Writes out all of the buffered text. */
+  void flush() {
+    if (used > 0) {
+      iovec iov[1] = {{buf.get(), used}};
+      write_all(iov, 1);
+      used = 0;
+    }
+  }
+};
+
+#endif //OUTPUT_SINK_H
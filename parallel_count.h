@@ -0,0 +1,224 @@
+/* parallel_count.h
+
+Copyright 2023 Roger D. Voss
+
+Created by github user roger-dv on 04/08/2023.
+
+Licensed under the MIT License - refer to LICENSE project document.
+
+*/
+#ifndef PARALLEL_COUNT_H
+#define PARALLEL_COUNT_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "concurrent_count_table.h"
+#include "count_occurrences.h"
+#include "input_source.h"
+#include "tokenizer.h"
+
+/**
+ * A chunk of input handed to a counting worker. When the input
+ * is memory mapped the chunk text refers directly into the mapping
+ * (which outlives the workers), otherwise the chunk owns a copy of
+ * the text, as the read() buffer of the input_source is reused.
+ */
+struct input_chunk {
+  std::string_view text{};
+  std::unique_ptr<char[]> owned{};
+};
+
+/**
+ * A bounded, blocking FIFO queue of input chunks shared by the
+ * thread reading the input and the counting workers. The reader
+ * blocks when the queue is full (so it can't run ahead of the
+ * workers) and the workers block when it's empty.
+ */
+class chunk_queue {
+private:
+  std::mutex mtx{};
+  std::condition_variable not_empty{}, not_full{};
+  std::deque<input_chunk> chunks{};
+  const std::size_t capacity;
+  bool closed = false;
+
+public:
+  explicit chunk_queue(std::size_t max_chunks) : capacity(max_chunks) {}
+  chunk_queue() = delete;
+  chunk_queue(const chunk_queue&) = delete;
+  chunk_queue(chunk_queue&&) = delete;
+  ~chunk_queue() = default;
+  chunk_queue&operator =(const chunk_queue&) = delete;
+  chunk_queue&operator =(chunk_queue&&) = delete;
+
+  void push(input_chunk &&chunk) {
+    std::unique_lock lock{mtx};
+    not_full.wait(lock, [this] { return chunks.size() < capacity; });
+    chunks.emplace_back(std::move(chunk));
+    lock.unlock();
+    not_empty.notify_one();
+  }
+
+  /**
+   * Takes the next chunk from the queue.
+   *
+   * @return the next chunk, or std::nullopt once the queue has
+   * been closed and drained
+   */
+  std::optional<input_chunk> pop() {
+    std::unique_lock lock{mtx};
+    not_empty.wait(lock, [this] { return !chunks.empty() || closed; });
+    if (chunks.empty()) { return std::nullopt; }
+    auto chunk = std::move(chunks.front());
+    chunks.pop_front();
+    lock.unlock();
+    not_full.notify_one();
+    return chunk;
+  }
+
+  /** No more chunks will be pushed - wakes up any waiting workers. */
+  void close() {
+    {
+      std::lock_guard lock{mtx};
+      closed = true;
+    }
+    not_empty.notify_all();
+  }
+};
+
+/**
+ * Makes a chunk of the input for a worker - a view into the input
+ * when it's memory mapped, else a copy of the text of the chunk.
+ *
+ * @param source the input the chunk is from
+ * @param text the text of the chunk
+ * @return the chunk
+ */
+inline input_chunk make_input_chunk(const input_source &source, const std::string_view text) {
+  input_chunk chunk{text};
+  if (!source.is_mapped()) {
+    chunk.owned = std::make_unique<char[]>(text.size());
+    std::ranges::copy(text, chunk.owned.get());
+    chunk.text = {chunk.owned.get(), text.size()};
+  }
+  return chunk;
+}
+
+/**
+ * Reads the input into the queue of chunks, on the calling thread,
+ * and then closes the queue (also if reading the input fails, so
+ * that the workers finish and can be joined).
+ *
+ * @param source the input to read
+ * @param queue the queue the workers take the chunks from
+ */
+inline void feed_chunks(input_source &source, chunk_queue &queue) {
+  try {
+    while (auto text = source.next_chunk()) { queue.push(make_input_chunk(source, *text)); }
+  } catch (...) {
+    queue.close();
+    throw;
+  }
+  queue.close();
+}
+
+/**
+ * The work of a counting worker thread - tokenizes the chunks of the
+ * queue and counts their words, until the queue is closed and empty.
+ *
+ * @tparam Counts type of the count table (or of the writer of one)
+ * @param queue the queue of chunks to count
+ * @param counts table the words are counted into
+ * @param tally receives the tally of the tokens seen by the worker
+ */
+template<typename Counts>
+void count_chunks(chunk_queue &queue, Counts &counts, token_tally &tally) {
+  word_splitter splitter{};
+  std::vector<std::string_view> words{};
+  while (auto chunk = queue.pop()) {
+    splitter.split(chunk->text, words);
+    count_words(counts, words);
+  }
+  tally = splitter.tally();
+}
+
+/**
+ * Counts the occurrence of the words of an input_source using
+ * several threads. The calling thread reads the input, splitting it
+ * into chunks on whitespace boundaries, and a pool of workers each
+ * tokenize chunks and count the words into a worker local table. When
+ * the input is exhausted the local tables are merged into one.
+ *
+ * As the chunks never split a word the merged counts are exactly
+ * those of counting the input on a single thread.
+ *
+ * @tparam Table type of the count table to accumulate into
+ * @param source the input to count the words of
+ * @param n_threads number of counting worker threads
+ * @param tally when not nullptr, the tally of the tokens seen by
+ * all of the workers is added to it
+ * @return count table where key is a word from the input and its
+ * associated value is count of its occurrence in the input.
+ */
+template<typename Table = count_table_t>
+Table count_occurrences_parallel(input_source &source, unsigned int n_threads, token_tally *tally = nullptr) {
+  chunk_queue queue{2 * std::size_t{n_threads}};
+  std::vector<Table> local_counts(n_threads);
+  std::vector<token_tally> local_tallies(n_threads);
+  {
+    std::vector<std::jthread> workers{};
+    workers.reserve(n_threads);
+    for(unsigned int i = 0; i < n_threads; i++) {
+      workers.emplace_back([&queue, &counts = local_counts[i], &worker_tally = local_tallies[i]] {
+        count_chunks(queue, counts, worker_tally);
+      });
+    }
+    feed_chunks(source, queue);
+  } // workers are joined here
+  add_tallies(tally, local_tallies);
+  return merge_tables(local_counts);
+}
+
+/**
+ * Counts the occurrence of the words of an input_source using
+ * several threads that all count into one shared concurrent_count_table
+ * (instead of each counting into a table of its own, that are then
+ * merged) - the table memory doesn't multiply by the thread count and
+ * there's no merge, at the cost of the atomic operations of counting.
+ * The input is read just as for count_occurrences_parallel().
+ *
+ * @param source the input to count the words of
+ * @param counts the shared table to count into - it's consolidated
+ * once the counting is done, to be read as a count table where key is
+ * a word from the input and its associated value is count of its
+ * occurrence in the input
+ * @param n_threads number of counting worker threads
+ * @param tally when not nullptr, the tally of the tokens seen by
+ * all of the workers is added to it
+ */
+inline void count_occurrences_shared(input_source &source, concurrent_count_table &counts, unsigned int n_threads,
+                                     token_tally *tally = nullptr) {
+  chunk_queue queue{2 * std::size_t{n_threads}};
+  std::vector<token_tally> local_tallies(n_threads);
+  {
+    std::vector<std::jthread> workers{};
+    workers.reserve(n_threads);
+    for(unsigned int i = 0; i < n_threads; i++) {
+      workers.emplace_back([&queue, writer = counts.make_writer(), &worker_tally = local_tallies[i]]() mutable {
+        count_chunks(queue, writer, worker_tally);
+      });
+    }
+    feed_chunks(source, queue);
+  } // workers are joined here
+  add_tallies(tally, local_tallies);
+  counts.consolidate();
+}
+
+#endif //PARALLEL_COUNT_H
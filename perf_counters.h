@@ -0,0 +1,113 @@
+/* perf_counters.h
+
+Copyright 2023 Roger D. Voss
+
+Created by github user roger-dv on 04/08/2023.
+
+Licensed under the MIT License - refer to LICENSE project document.
+
+*/
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/**
+ * The hardware events that perf_counters counts.
+ */
+enum class perf_event : std::size_t { cycles, instructions, llc_misses, branch_misses, dtlb_misses };
+
+constexpr std::size_t perf_event_count = 5;
+
+inline const char* perf_event_name(const perf_event event) {
+  static const char *const names[perf_event_count] = {
+      "cycles", "instructions", "llc_misses", "branch_misses", "dtlb_misses"
+  };
+  return names[static_cast<std::size_t>(event)];
+}
+
+/**
+ * A reading of each of the perf_event counters - an event the
+ * CPU (or kernel, or virtual machine) can't count has no value.
+ */
+using perf_reading = std::array<std::optional<std::uint64_t>, perf_event_count>;
+
+/**
+ * Hardware performance counters of this process (and of the threads
+ * it creates once the counters are opened), by way of the Linux
+ * perf_event_open(2) system call. Only user space is counted, so
+ * the default perf_event_paranoid setting suffices. Any event that
+ * can not be opened is simply not counted.
+ */
+class perf_counters {
+private:
+  std::array<int, perf_event_count> fds{};
+
+  static int open_event(std::uint32_t type, std::uint64_t config) {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.inherit = 1; // also count the worker threads
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+  }
+
+public:
+  perf_counters() {
+    fds[static_cast<std::size_t>(perf_event::cycles)] =
+        open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    fds[static_cast<std::size_t>(perf_event::instructions)] =
+        open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    fds[static_cast<std::size_t>(perf_event::llc_misses)] =
+        open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    fds[static_cast<std::size_t>(perf_event::branch_misses)] =
+        open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    fds[static_cast<std::size_t>(perf_event::dtlb_misses)] =
+        open_event(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB |
+                                       (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                       (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+  }
+  perf_counters(const perf_counters &) = delete;
+  perf_counters(perf_counters &&) = delete;
+  perf_counters& operator=(const perf_counters &) = delete;
+  perf_counters& operator=(perf_counters &&) = delete;
+  ~perf_counters() {
+    for(const auto fd : fds) {
+      if (fd >= 0) { ::close(fd); }
+    }
+  }
+
+  /**
+   * Reads the counters. When the kernel has had to multiplex more
+   * events than the PMU has counters, the counts are scaled up by
+   * the fraction of the time the event was actually counted.
+   *
+   * @return the current counts
+   */
+  [[nodiscard]] perf_reading read() const {
+    perf_reading reading{};
+    for(std::size_t i = 0; i < perf_event_count; i++) {
+      std::uint64_t values[3]; // value, time enabled, time running
+      if (fds[i] < 0 || ::read(fds[i], values, sizeof(values)) != static_cast<ssize_t>(sizeof(values))) { continue; }
+      if (values[2] == 0) {
+        reading[i] = 0;
+      } else if (values[2] < values[1]) {
+        reading[i] = static_cast<std::uint64_t>(static_cast<double>(values[0]) *
+                                                static_cast<double>(values[1]) / static_cast<double>(values[2]));
+      } else {
+        reading[i] = values[0];
+      }
+    }
+    return reading;
+  }
+};
+
+#endif //PERF_COUNTERS_H
@@ -0,0 +1,139 @@
+/* pipeline_count.h
+
+Copyright 2023 Roger D. Voss
+
+Created by github user roger-dv on 04/08/2023.
+
+Licensed under the MIT License - refer to LICENSE project document.
+
+*/
+#ifndef PIPELINE_COUNT_H
+#define PIPELINE_COUNT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "count_occurrences.h"
+#include "flat_count_table.h"
+#include "input_source.h"
+#include "parallel_count.h"
+#include "ring_buffer.h"
+#include "tokenizer.h"
+
+/**
+ * A batch of (lower cased) words bound for one counter - the bytes
+ * of the words back to back and the end offset of each word.
+ */
+struct token_batch {
+  static constexpr std::size_t capacity = 64 * 1024;
+  std::string text{};
+  std::vector<std::uint32_t> ends{};
+};
+
+/**
+ * Counts the occurrence of the words of an input_source as a staged
+ * pipeline, so that reading, tokenizing and counting all overlap:
+ *
+ *   reader     - the calling thread pulls chunks (split on whitespace
+ *                boundaries) from the input and deals them round robin
+ *                to the tokenizers, each over its own SPSC ring
+ *   tokenizers - split their chunks into words and batch each word for
+ *                the counter that owns the word (by hash of the word)
+ *   counters   - each consumes batches over an MPSC ring (fed by all
+ *                tokenizers) and counts into its own table
+ *
+ * As each word is only ever counted by the one counter, the tables of
+ * the counters are disjoint and combining them is a plain union. All
+ * of the rings are bounded, so a stage that falls behind throttles the
+ * stages feeding it and the reader never runs ahead of the counting.
+ *
+ * @tparam Table type of the count table to accumulate into
+ * @param source the input to count the words of
+ * @param n_tokenizers number of tokenizer threads
+ * @param n_counters number of counter threads
+ * @param tally when not nullptr, the tally of the tokens seen by
+ * all of the tokenizers is added to it
+ * @return count table where key is a word from the input and its
+ * associated value is count of its occurrence in the input.
+ */
+template<typename Table = count_table_t>
+Table count_occurrences_pipelined(input_source &source, unsigned int n_tokenizers, unsigned int n_counters,
+                                  token_tally *tally = nullptr) {
+  std::vector<std::unique_ptr<spsc_ring<input_chunk>>> chunk_rings{};
+  std::vector<std::unique_ptr<mpsc_ring<token_batch>>> batch_rings{};
+  for(unsigned int i = 0; i < n_tokenizers; i++) { chunk_rings.push_back(std::make_unique<spsc_ring<input_chunk>>(4)); }
+  for(unsigned int i = 0; i < n_counters; i++) {
+    batch_rings.push_back(std::make_unique<mpsc_ring<token_batch>>(4 * std::size_t{n_tokenizers}));
+  }
+  std::vector<Table> local_counts(n_counters);
+  std::vector<token_tally> local_tallies(n_tokenizers);
+  {
+    std::vector<std::jthread> counters{};
+    counters.reserve(n_counters);
+    for(unsigned int i = 0; i < n_counters; i++) {
+      counters.emplace_back([&ring = *batch_rings[i], &counts = local_counts[i]] {
+        while (auto batch = ring.pop()) {
+          std::uint32_t start = 0;
+          for(const auto end : batch->ends) {
+            count_word(counts, std::string_view{batch->text}.substr(start, end - start));
+            start = end;
+          }
+        }
+      });
+    }
+    {
+      std::vector<std::jthread> tokenizers{};
+      tokenizers.reserve(n_tokenizers);
+      for(unsigned int i = 0; i < n_tokenizers; i++) {
+        tokenizers.emplace_back([&ring = *chunk_rings[i], &batch_rings, &tokenizer_tally = local_tallies[i]] {
+          const auto n = batch_rings.size();
+          word_splitter splitter{};
+          std::vector<std::string_view> words{};
+          std::vector<token_batch> batches(n);
+          auto const send = [&batch_rings, &batches](std::size_t c) {
+            batch_rings[c]->push(std::move(batches[c]));
+            batches[c] = token_batch{};
+          };
+          while (auto chunk = ring.pop()) {
+            splitter.split(chunk->text, words);
+            for(const auto word : words) {
+              const auto c = n == 1 ? 0 : static_cast<std::size_t>(hash_word(word) >> 32) % n;
+              auto &batch = batches[c];
+              if (batch.text.empty()) { batch.text.reserve(token_batch::capacity); }
+              batch.text += word;
+              batch.ends.push_back(static_cast<std::uint32_t>(batch.text.size()));
+              if (batch.text.size() >= token_batch::capacity) { send(c); }
+            }
+          }
+          for(std::size_t c = 0; c < n; c++) {
+            if (!batches[c].ends.empty()) { send(c); }
+          }
+          tokenizer_tally = splitter.tally();
+        });
+      }
+      try {
+        for(std::size_t next = 0; auto text = source.next_chunk(); next = (next + 1) % n_tokenizers) {
+          chunk_rings[next]->push(make_input_chunk(source, *text));
+        }
+      } catch (...) {
+        // let the stages drain so their threads can be joined
+        std::ranges::for_each(chunk_rings, [](auto &ring) { ring->close(); });
+        tokenizers.clear();
+        std::ranges::for_each(batch_rings, [](auto &ring) { ring->close(); });
+        throw;
+      }
+      std::ranges::for_each(chunk_rings, [](auto &ring) { ring->close(); });
+    } // tokenizers are joined here
+    std::ranges::for_each(batch_rings, [](auto &ring) { ring->close(); });
+  } // counters are joined here
+  add_tallies(tally, local_tallies);
+
+  // the counter tables are disjoint - gathering them into one is a plain union
+  return merge_tables(local_counts);
+}
+
+#endif //PIPELINE_COUNT_H
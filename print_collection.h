@@ -0,0 +1,42 @@
+/* print_collection.h
+
+Copyright 2023 Roger D. Voss
+
+Created by github user roger-dv on 04/08/2023.
+
+Licensed under the MIT License - refer to LICENSE project document.
+
+*/
+#ifndef PRINT_COLLECTION_H
+#define PRINT_COLLECTION_H
+
+#include <algorithm>
+#include <concepts>
+#include <ranges>
+#include "output_sink.h"
+#include "ranking.h"
+
+/**
+ * For a collection passed as input, prints out its
+ * elements to stdout. The collection element is a
+ * tuple consisting of a paired integer and string.
+ * Each element is printed on a single line.
+ *
+ * The lines are formatted into a large buffer that
+ * is written to stdout with write() as it fills.
+ *
+ * @tparam C input collection type (must support ranges)
+ * @tparam E collection element type - must be a tuple
+ * consisting of a paired unsigned integer and string.
+ * @param coll input collection
+ * @param fd file descriptor to print to (stdout by default)
+ */
+template<typename C, typename E = typename C::value_type>
+  requires std::ranges::range<C> && std::same_as<E, count_pair_t>
+void print_collection(const C &coll, int fd = STDOUT_FILENO) {
+  output_sink out{fd};
+  std::ranges::for_each(coll, [&out](const E &elem){ out << elem.first << ": " << elem.second << '\n'; });
+  out.flush();
+}
+
+#endif //PRINT_COLLECTION_H
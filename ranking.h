@@ -0,0 +1,235 @@
+/* ranking.h
+
+Copyright 2023 Roger D. Voss
+
+Created by github user roger-dv on 04/08/2023.
+
+Licensed under the MIT License - refer to LICENSE project document.
+
+*/
+#ifndef RANKING_H
+#define RANKING_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <ranges>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "string_sort.h"
+#include "task_pool.h"
+
+// the word refers to the key of the count table that the word was counted in (whose
+// storage therefore must outlive the count pair) - no bytes of the word are duplicated
+using count_pair_t = std::pair<unsigned int, std::string_view>;
+
+/**
+ * The packed 8 byte record that stands in for a count pair while it's
+ * being ranked - the first 4 bytes of its word, as a big endian key
+ * (zero padded), and the index of the pair as the id of its word.
+ *
+ * Within a bucket of the ranking the count is implied, and the order
+ * of the prefix keys agrees with the lexical order of the words - so
+ * most words are ordered by their prefix key alone, without leaving
+ * the array of records to look up the word.
+ */
+struct rank_record {
+  std::uint32_t prefix;
+  std::uint32_t word_id;
+};
+
+namespace ranking_detail {
+
+/**
+ * Sorts rank records on their prefix key - by an LSD radix sort, a
+ * byte of the key per pass, for all but a small range.
+ */
+template<std::random_access_iterator It>
+void sort_on_prefix(It first, It last) {
+  const auto n = static_cast<std::size_t>(last - first);
+  if (n < 256) {
+    std::sort(first, last, [](const rank_record &x, const rank_record &y) { return x.prefix < y.prefix; });
+    return;
+  }
+  std::array<std::array<std::size_t, 256>, 4> counts{};
+  std::for_each(first, last, [&counts](const rank_record &record) {
+    for(unsigned int b = 0; b < 4; b++) { counts[b][(record.prefix >> (8 * b)) & 0xffu]++; }
+  });
+  std::vector<rank_record> buffer(n);
+  auto from = std::to_address(first), to = buffer.data();
+  for(unsigned int b = 0; b < 4; b++) {
+    auto &offsets = counts[b];
+    if (std::ranges::find(offsets, n) != offsets.end()) { continue; } // all the keys have the same byte
+    std::exclusive_scan(offsets.begin(), offsets.end(), offsets.begin(), std::size_t{0});
+    std::for_each(from, from + n, [&offsets, to, b](const rank_record &record) {
+      to[offsets[(record.prefix >> (8 * b)) & 0xffu]++] = record;
+    });
+    std::swap(from, to);
+  }
+  if (from != std::to_address(first)) { std::copy(from, from + n, first); }
+}
+
+} // namespace ranking_detail
+
+/**
+ * Sorts count pairs into ranked order - descending on their count,
+ * then lexically ascending on their word (a byte-wise comparison, as
+ * std::string_view::compare()) - by bucketing them on their count
+ * rather than by comparison sorting them all.
+ *
+ * Word frequencies are heavily skewed (Zipf's law) - most words of a
+ * vocabulary have a count of just a few, while only a few words have
+ * large counts. So the pairs of a count up to a limit are distributed
+ * by a counting sort into a dense array of buckets, one per count, in
+ * O(V); the few pairs of a larger count are comparison sorted as an
+ * overflow that precedes the buckets. Then only the words within each
+ * bucket are left to be sorted.
+ *
+ * When top_k is non-zero only the top_k highest ranked pairs are
+ * retained (like the 'sed ${1}q' step of McIlroy's pipeline) - and
+ * only the buckets that are emitted are sorted (the last of them
+ * partially).
+ *
+ * The sorts of the buckets are independent of each other, so they
+ * can be run on several threads at once. So that one huge bucket
+ * (in particular that of the words of count 1, often most of the
+ * vocabulary) doesn't hold up the rest, a large bucket is first
+ * partitioned on the first byte of its words into sub-ranges, which
+ * are then sorted independently as well.
+ *
+ * It's not the count pairs themselves that are distributed and sorted
+ * but packed rank_record stand-ins for them, and a bucket is sorted on
+ * the prefix keys of its records. Only the runs of records that tie on
+ * their prefix key look up their words, to be sorted by multikey
+ * quicksort (string_sort.h) - the ranked pairs are gathered up, in
+ * their final order, at the end.
+ *
+ * @param count_pairs the pairs to rank (is sorted and truncated
+ * in place)
+ * @param top_k count of highest ranked pairs to retain (zero means
+ * retain all of them)
+ * @param n_threads number of threads to sort on
+ */
+inline void rank_count_pairs(std::vector<count_pair_t> &count_pairs, std::size_t top_k = 0, unsigned int n_threads = 1) {
+  constexpr std::size_t parallel_split_size = 64 * 1024;
+  const auto n = count_pairs.size();
+  const auto emitted = top_k > 0 ? std::min(top_k, n) : n;
+
+  // a bucket per count up to the limit - the size of the array of buckets is
+  // bounded by the number of pairs, so bucketing is O(V) in time and space
+  const auto dense_limit = static_cast<unsigned int>(std::min<std::size_t>(std::max<std::size_t>(n, 1024), 1u << 20));
+  std::vector<std::size_t> bucket_ends(dense_limit + 1);
+  std::size_t n_overflow = 0;
+  for(const auto &[count, word] : count_pairs) {
+    if (count > dense_limit) {
+      n_overflow++;
+    } else {
+      bucket_ends[count]++;
+    }
+  }
+  // the buckets follow the overflow, in order of descending count
+  for(std::size_t end = n_overflow, c = dense_limit + 1; c-- > 0;) {
+    end += bucket_ends[c];
+    bucket_ends[c] = end;
+  }
+
+  // the count pairs stay put as the pool of the words - it's their packed records that are ranked
+  auto const prefix_of = [](const std::string_view word) {
+    std::uint32_t prefix = 0;
+    for(std::size_t i = 0; i < 4; i++) {
+      prefix = prefix << 8 | (i < word.size() ? static_cast<unsigned char>(word[i]) : 0u);
+    }
+    return prefix;
+  };
+  std::vector<rank_record> ranked(n);
+  std::size_t next_overflow = 0;
+  for(std::uint32_t id = 0; id < n; id++) {
+    const auto &[count, word] = count_pairs[id];
+    const rank_record record{prefix_of(word), id};
+    if (count > dense_limit) {
+      ranked[next_overflow++] = record;
+    } else {
+      ranked[--bucket_ends[count]] = record; // fills each bucket back to front
+    }
+  }
+  // bucket_ends[c] is now the start of the bucket of count c
+
+  // the sorts of the overflow and of the emitted buckets are independent of each other, so
+  // they're gathered up as tasks that can be run across threads (the largest first)
+  const auto first = ranked.begin();
+  auto const at = [&first](std::size_t i) { return first + static_cast<std::ptrdiff_t>(i); };
+  auto const word_key = [&count_pairs](const rank_record &record) { return count_pairs[record.word_id].second; };
+  auto const by_word = [&word_key](const rank_record &x, const rank_record &y) {
+    return x.prefix != y.prefix ? x.prefix < y.prefix : word_key(x).compare(word_key(y)) < 0;
+  };
+  auto const by_rank = [&count_pairs, &by_word](const rank_record &x, const rank_record &y) {
+    const auto cx = count_pairs[x.word_id].first, cy = count_pairs[y.word_id].first;
+    return cx != cy ? cx > cy : by_word(x, y);
+  };
+  auto const sort_words = [&word_key](auto begin, auto end) {
+    ranking_detail::sort_on_prefix(begin, end);
+    // then the runs that tie on their prefix key - whose words share their first 4 bytes, unless
+    // the prefix is zero padded (a word shorter than 4 bytes), so the string sort starts past them
+    while (begin != end) {
+      const auto run_end = std::find_if(begin, end, [prefix = begin->prefix](const rank_record &record) {
+        return record.prefix != prefix;
+      });
+      if (run_end - begin > 1) {
+        multikey_quicksort(begin, run_end, (begin->prefix & 0xffu) != 0 ? 4 : 0, word_key);
+      }
+      begin = run_end;
+    }
+  };
+  std::vector<std::pair<std::size_t, std::function<void()>>> sorts{};
+  auto const add_sorts = [&](std::size_t begin, std::size_t end, bool is_bucket) {
+    if (begin >= emitted || end - begin < 2) { return; }
+    if (end > emitted) {
+      sorts.emplace_back(end - begin, [=] {
+        if (is_bucket) {
+          std::partial_sort(at(begin), at(emitted), at(end), by_word);
+        } else {
+          std::partial_sort(at(begin), at(emitted), at(end), by_rank);
+        }
+      });
+    } else if (!is_bucket) {
+      sorts.emplace_back(end - begin, [=] { std::sort(at(begin), at(end), by_rank); });
+    } else if (n_threads > 1 && end - begin >= parallel_split_size) {
+      // a large bucket (such as of the words of count 1) is split on the first byte of its
+      // words into sub-ranges that are sorted independently of each other
+      const auto bounds = partition_into<256>(at(begin), at(end), [](const rank_record &record) {
+        return static_cast<std::size_t>(record.prefix >> 24);
+      });
+      for(std::size_t b = 0; b + 1 < bounds.size(); b++) {
+        const auto sub_begin = begin + static_cast<std::size_t>(bounds[b]);
+        const auto sub_end = begin + static_cast<std::size_t>(bounds[b + 1]);
+        if (sub_end - sub_begin < 2) { continue; }
+        sorts.emplace_back(sub_end - sub_begin, [=] { sort_words(at(sub_begin), at(sub_end)); });
+      }
+    } else {
+      sorts.emplace_back(end - begin, [=] { sort_words(at(begin), at(end)); });
+    }
+  };
+  add_sorts(0, n_overflow, false);
+  for(std::size_t begin = n_overflow, c = dense_limit + 1; c-- > 0 && begin < emitted;) {
+    const auto end = c > 0 ? bucket_ends[c - 1] : n;
+    add_sorts(begin, end, true);
+    begin = end;
+  }
+  std::ranges::stable_sort(sorts, std::ranges::greater{}, [](const auto &sort) { return sort.first; });
+  std::vector<std::function<void()>> tasks{};
+  tasks.reserve(sorts.size());
+  std::ranges::move(std::views::values(sorts), std::back_inserter(tasks));
+  run_tasks(tasks, n_threads);
+
+  std::vector<count_pair_t> ranked_pairs(emitted);
+  std::ranges::transform(ranked | std::views::take(emitted), ranked_pairs.begin(),
+                         [&count_pairs](const rank_record &record) { return count_pairs[record.word_id]; });
+  count_pairs.swap(ranked_pairs);
+}
+
+#endif //RANKING_H
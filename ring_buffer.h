@@ -0,0 +1,175 @@
+/* ring_buffer.h
+
+Copyright 2023 Roger D. Voss
+
+Created by github user roger-dv on 04/08/2023.
+
+Licensed under the MIT License - refer to LICENSE project document.
+
+*/
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+
+// Bounded lock-free ring buffers that connect the stages of the
+// counting pipeline. A full ring blocks its producers and an empty
+// ring blocks its consumer (backpressure) - they first spin briefly
+// and then sleep in std::atomic<>::wait() until the other side moves.
+// Once close() is called, and the ring drains, pop() returns nullopt.
+
+namespace ring_detail {
+
+constexpr std::size_t cache_line = 64;
+// set in the publish counter of a ring once the ring is closed
+constexpr std::uint64_t closed_bit = std::uint64_t{1} << 63;
+constexpr int spin_limit = 64;
+
+inline std::size_t capacity_for(std::size_t n) noexcept { return std::bit_ceil(n < 2 ? std::size_t{2} : n); }
+
+} // namespace ring_detail
+
+/**
+ * Single producer, single consumer ring buffer.
+ *
+ * @tparam T type of the elements (default constructible, movable)
+ */
+template<typename T>
+class spsc_ring {
+private:
+  const std::size_t mask;
+  const std::unique_ptr<T[]> slots;
+  alignas(ring_detail::cache_line) std::atomic<std::uint64_t> head{0}; // next slot to pop
+  alignas(ring_detail::cache_line) std::atomic<std::uint64_t> tail{0}; // next slot to push (and closed_bit)
+
+public:
+  /** @param capacity number of elements (rounded up to a power of two) */
+  explicit spsc_ring(std::size_t capacity)
+      : mask(ring_detail::capacity_for(capacity) - 1), slots(std::make_unique<T[]>(mask + 1)) {}
+  spsc_ring() = delete;
+  spsc_ring(const spsc_ring&) = delete;
+  spsc_ring(spsc_ring&&) = delete;
+  ~spsc_ring() = default;
+  spsc_ring& operator=(const spsc_ring&) = delete;
+  spsc_ring& operator=(spsc_ring&&) = delete;
+
+  void push(T &&value) {
+    const auto t = tail.load(std::memory_order_relaxed);
+    for(int spins = 0;; spins++) {
+      const auto h = head.load(std::memory_order_acquire);
+      if (t - h <= mask) { break; }
+      if (spins >= ring_detail::spin_limit) { head.wait(h, std::memory_order_acquire); }
+    }
+    slots[t & mask] = std::move(value);
+    tail.store(t + 1, std::memory_order_release);
+    tail.notify_one();
+  }
+
+  std::optional<T> pop() {
+    const auto h = head.load(std::memory_order_relaxed);
+    for(int spins = 0;; spins++) {
+      const auto t = tail.load(std::memory_order_acquire);
+      if ((t & ~ring_detail::closed_bit) != h) { break; }
+      if ((t & ring_detail::closed_bit) != 0) { return std::nullopt; }
+      if (spins >= ring_detail::spin_limit) { tail.wait(t, std::memory_order_acquire); }
+    }
+    std::optional<T> value{std::move(slots[h & mask])};
+    head.store(h + 1, std::memory_order_release);
+    head.notify_one();
+    return value;
+  }
+
+  /** Called by the producer once it has pushed its last element. */
+  void close() {
+    tail.fetch_or(ring_detail::closed_bit, std::memory_order_release);
+    tail.notify_all();
+  }
+};
+
+/**
+ * Multiple producer, single consumer ring buffer - the producers
+ * claim slots with a CAS on the tail index and each slot has a
+ * sequence number that marks it as published (after D. Vyukov's
+ * bounded MPMC queue).
+ *
+ * @tparam T type of the elements (default constructible, movable)
+ */
+template<typename T>
+class mpsc_ring {
+private:
+  struct cell {
+    std::atomic<std::uint64_t> sequence{0};
+    T value{};
+  };
+
+  const std::size_t mask;
+  const std::unique_ptr<cell[]> cells;
+  alignas(ring_detail::cache_line) std::atomic<std::uint64_t> head{0};      // next cell to pop
+  alignas(ring_detail::cache_line) std::atomic<std::uint64_t> tail{0};      // next cell to claim
+  alignas(ring_detail::cache_line) std::atomic<std::uint64_t> published{0}; // count of pushes (and closed_bit)
+
+public:
+  /** @param capacity number of elements (rounded up to a power of two) */
+  explicit mpsc_ring(std::size_t capacity)
+      : mask(ring_detail::capacity_for(capacity) - 1), cells(std::make_unique<cell[]>(mask + 1)) {
+    for(std::size_t i = 0; i <= mask; i++) { cells[i].sequence.store(i, std::memory_order_relaxed); }
+  }
+  mpsc_ring() = delete;
+  mpsc_ring(const mpsc_ring&) = delete;
+  mpsc_ring(mpsc_ring&&) = delete;
+  ~mpsc_ring() = default;
+  mpsc_ring& operator=(const mpsc_ring&) = delete;
+  mpsc_ring& operator=(mpsc_ring&&) = delete;
+
+  void push(T &&value) {
+    auto pos = tail.load(std::memory_order_relaxed);
+    for(int spins = 0;; spins++) {
+      const auto h = head.load(std::memory_order_acquire);
+      auto &c = cells[pos & mask];
+      const auto sequence = c.sequence.load(std::memory_order_acquire);
+      if (sequence == pos) {
+        if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) { break; }
+      } else if (sequence < pos) { // the ring is full
+        if (spins >= ring_detail::spin_limit && pos - h > mask) { head.wait(h, std::memory_order_acquire); }
+        pos = tail.load(std::memory_order_relaxed);
+      } else { // another producer claimed the cell
+        pos = tail.load(std::memory_order_relaxed);
+      }
+    }
+    auto &c = cells[pos & mask];
+    c.value = std::move(value);
+    c.sequence.store(pos + 1, std::memory_order_release);
+    published.fetch_add(1, std::memory_order_release);
+    published.notify_one();
+  }
+
+  std::optional<T> pop() {
+    const auto h = head.load(std::memory_order_relaxed);
+    auto &c = cells[h & mask];
+    for(int spins = 0;; spins++) {
+      const auto p = published.load(std::memory_order_acquire);
+      if (c.sequence.load(std::memory_order_acquire) == h + 1) { break; }
+      if ((p & ring_detail::closed_bit) != 0) { return std::nullopt; }
+      if (spins >= ring_detail::spin_limit) { published.wait(p, std::memory_order_acquire); }
+    }
+    std::optional<T> value{std::move(c.value)};
+    c.sequence.store(h + mask + 1, std::memory_order_release);
+    head.store(h + 1, std::memory_order_release);
+    head.notify_all();
+    return value;
+  }
+
+  /** Called once all of the producers have pushed their last element. */
+  void close() {
+    published.fetch_or(ring_detail::closed_bit, std::memory_order_release);
+    published.notify_all();
+  }
+};
+
+#endif //RING_BUFFER_H
@@ -0,0 +1,210 @@
+/* stats.h
+
+Copyright 2023 Roger D. Voss
+
+Created by github user roger-dv on 04/08/2023.
+
+Licensed under the MIT License - refer to LICENSE project document.
+
+*/
+#ifndef STATS_H
+#define STATS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <sys/resource.h>
+#include "concurrent_count_table.h"
+#include "count_occurrences.h"
+#include "perf_counters.h"
+#include "tokenizer.h"
+
+/**
+ * The time, and optionally the hardware counter deltas, of a phase.
+ */
+struct phase_stats {
+  const char *name;
+  double ms = 0;
+  perf_reading counters{};
+};
+
+/**
+ * Times the phases of the program - each call of lap() records the
+ * time elapsed since the prior lap (or since construction). A phase
+ * that is lapped more than once accumulates its times. When asked
+ * to, it also records the hardware performance counters per phase.
+ */
+class phase_timer {
+private:
+  using clock = std::chrono::steady_clock;
+  std::unique_ptr<perf_counters> perf{};
+  perf_reading last_reading{};
+  clock::time_point started = clock::now();
+  clock::time_point last_lap = started;
+  std::vector<phase_stats> laps{};
+
+public:
+  /**
+   * @param count_perf_events when true the hardware performance
+   * counters are also recorded for each phase
+   */
+  explicit phase_timer(bool count_perf_events = false) {
+    if (count_perf_events) {
+      perf = std::make_unique<perf_counters>();
+      last_reading = perf->read();
+    }
+    started = last_lap = clock::now();
+  }
+
+  /**
+   * Ends the current phase.
+   *
+   * @param phase name of the phase that just ended
+   */
+  void lap(const char *phase) {
+    const auto now = clock::now();
+    const auto reading = perf ? perf->read() : perf_reading{};
+    auto it = std::ranges::find(laps, std::string_view{phase}, [](const auto &p) { return std::string_view{p.name}; });
+    if (it == laps.end()) { it = laps.insert(it, phase_stats{phase}); }
+    it->ms += std::chrono::duration<double, std::milli>(now - last_lap).count();
+    for(std::size_t i = 0; i < perf_event_count; i++) {
+      if (reading[i] && last_reading[i]) { it->counters[i] = it->counters[i].value_or(0) + *reading[i] - *last_reading[i]; }
+    }
+    last_lap = now;
+    last_reading = reading;
+  }
+
+  [[nodiscard]] double elapsed_ms() const {
+    return std::chrono::duration<double, std::milli>(clock::now() - started).count();
+  }
+
+  [[nodiscard]] bool counts_perf_events() const noexcept { return perf != nullptr; }
+
+  [[nodiscard]] const std::vector<phase_stats>& phases() const noexcept { return laps; }
+};
+
+/**
+ * @return peak resident set size of the process in KiB
+ */
+inline long peak_rss_kb() {
+  rusage usage{};
+  return ::getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : 0;
+}
+
+/**
+ * Probe sequence lengths of flat_count_table - slots inspected by
+ * a successful lookup of each word.
+ *
+ * @return pair of the mean and the maximum probe length
+ */
+inline std::pair<double, std::size_t> probe_lengths(const flat_count_table &counts) {
+  return counts.probe_lengths();
+}
+
+/**
+ * Probe sequence lengths of concurrent_count_table - slots inspected
+ * by a successful lookup of each word, over all of the levels probed.
+ *
+ * @return pair of the mean and the maximum probe length
+ */
+inline std::pair<double, std::size_t> probe_lengths(const concurrent_count_table &counts) {
+  return counts.probe_lengths();
+}
+
+/**
+ * The std::unordered_map analog of probe sequence length - the
+ * length of the bucket chain that a word is found in.
+ *
+ * @return pair of the mean and the maximum chain length
+ */
+inline std::pair<double, std::size_t> probe_lengths(const std_count_table_t &counts) {
+  std::size_t total = 0, longest = 0;
+  for(std::size_t i = 0; i < counts.bucket_count(); i++) {
+    const auto n = counts.bucket_size(i);
+    total += n * n; // each of the n words of the chain are on average (n + 1) / 2 deep
+    longest = std::max(longest, n);
+  }
+  const auto n_words = static_cast<double>(counts.size());
+  return {n_words > 0 ? (static_cast<double>(total) / n_words + 1) / 2 : 0.0, longest};
+}
+
+/**
+ * Writes the hardware counters of each phase as the "perf" member
+ * of the statistics JSON object - the raw counts, the instructions
+ * per cycle and each of the miss counts per token seen. A counter
+ * that is not available is null.
+ *
+ * @param timer phase timings (and counters) of the run
+ * @param tally tokens seen and words accepted
+ */
+inline void print_perf_json(const phase_timer &timer, const token_tally &tally) {
+  auto const print_value = [](const std::optional<double> value, const char *format) {
+    if (value) { fprintf(stderr, format, *value); } else { fprintf(stderr, "null"); }
+  };
+  auto const as_double = [](const std::optional<std::uint64_t> n) -> std::optional<double> {
+    if (n) { return static_cast<double>(*n); }
+    return std::nullopt;
+  };
+  const auto tokens = static_cast<double>(tally.tokens);
+  fprintf(stderr, ",\"perf\":{");
+  std::string_view separator{};
+  for(const auto &phase : timer.phases()) {
+    fprintf(stderr, "%.*s\"%s\":{", static_cast<int>(separator.size()), separator.data(), phase.name);
+    separator = ",";
+    for(std::size_t i = 0; i < perf_event_count; i++) {
+      fprintf(stderr, "%s\"%s\":", i > 0 ? "," : "", perf_event_name(static_cast<perf_event>(i)));
+      print_value(as_double(phase.counters[i]), "%.0f");
+    }
+    const auto cycles = as_double(phase.counters[static_cast<std::size_t>(perf_event::cycles)]);
+    const auto instructions = as_double(phase.counters[static_cast<std::size_t>(perf_event::instructions)]);
+    fprintf(stderr, ",\"ipc\":");
+    print_value(cycles && instructions && *cycles > 0 ? std::optional{*instructions / *cycles} : std::nullopt, "%.3f");
+    for(const auto event : {perf_event::llc_misses, perf_event::branch_misses, perf_event::dtlb_misses}) {
+      const auto misses = as_double(phase.counters[static_cast<std::size_t>(event)]);
+      fprintf(stderr, ",\"%s_per_token\":", perf_event_name(event));
+      print_value(misses && tokens > 0 ? std::optional{*misses / tokens} : std::nullopt, "%.6f");
+    }
+    fprintf(stderr, "}");
+  }
+  fprintf(stderr, "}");
+}
+
+/**
+ * Writes the run statistics to stderr as one JSON object on a
+ * single line, for consumption by job schedulers and the like.
+ *
+ * @tparam Table type of the count table
+ * @param timer phase timings of the run
+ * @param bytes_read count of input bytes
+ * @param tally tokens seen and words accepted
+ * @param counts_map the word counts
+ * @param threads count of counting threads
+ */
+template<typename Table>
+void print_stats_json(const phase_timer &timer, std::size_t bytes_read, const token_tally &tally,
+                      const Table &counts_map, unsigned int threads) {
+  const auto [mean_probe, max_probe] = probe_lengths(counts_map);
+  fprintf(stderr,
+          "{\"wall_ms\":%.3f,\"threads\":%u,\"bytes_read\":%zu,\"tokens_seen\":%llu,\"tokens_rejected\":%llu,"
+          "\"words_counted\":%llu,\"distinct_words\":%zu,\"load_factor\":%.4f,\"mean_probe_length\":%.4f,"
+          "\"max_probe_length\":%zu,\"peak_rss_kb\":%ld,\"phases_ms\":{",
+          timer.elapsed_ms(), threads, bytes_read, static_cast<unsigned long long>(tally.tokens),
+          static_cast<unsigned long long>(tally.tokens - tally.words), static_cast<unsigned long long>(tally.words),
+          counts_map.size(), static_cast<double>(counts_map.load_factor()), mean_probe, max_probe, peak_rss_kb());
+  std::string_view separator{};
+  for(const auto &phase : timer.phases()) {
+    fprintf(stderr, "%.*s\"%s\":%.3f", static_cast<int>(separator.size()), separator.data(), phase.name, phase.ms);
+    separator = ",";
+  }
+  fprintf(stderr, "}");
+  if (timer.counts_perf_events()) {
+    print_perf_json(timer, tally);
+  }
+  fprintf(stderr, "}\n");
+}
+
+#endif //STATS_H
@@ -0,0 +1,139 @@
+/* string_sort.h
+
+Copyright 2023 Roger D. Voss
+
+Created by github user roger-dv on 04/08/2023.
+
+Licensed under the MIT License - refer to LICENSE project document.
+
+*/
+#ifndef STRING_SORT_H
+#define STRING_SORT_H
+
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <string_view>
+#include <utility>
+
+namespace string_sort_detail {
+
+constexpr std::ptrdiff_t insertion_sort_limit = 16;
+
+/** @return byte d of the string (as unsigned char), or -1 past its end */
+inline int byte_at(const std::string_view s, std::size_t d) noexcept {
+  return d < s.size() ? static_cast<unsigned char>(s[d]) : -1;
+}
+
+template<typename It, typename Key>
+void insertion_sort(It first, It last, std::size_t depth, Key &key) {
+  // the strings of the range share their first depth bytes
+  auto const less = [depth, &key](const auto &x, const auto &y) {
+    return key(x).substr(std::min(depth, key(x).size())) < key(y).substr(std::min(depth, key(y).size()));
+  };
+  for(auto i = first; i != last; ++i) {
+    for(auto j = i; j != first && less(*j, *std::prev(j)); --j) { std::iter_swap(j, std::prev(j)); }
+  }
+}
+
+template<typename It, typename Key>
+void sort_from(It first, It last, std::size_t depth, Key &key) {
+  while (last - first > insertion_sort_limit) {
+    // median of three pivot byte
+    const auto mid = first + (last - first) / 2;
+    int a = byte_at(key(*first), depth), b = byte_at(key(*mid), depth), c = byte_at(key(*std::prev(last)), depth);
+    if (a > b) { std::swap(a, b); }
+    const int pivot = c < a ? a : (c > b ? b : c);
+
+    // three way partition on the byte at depth: [first, lt) < pivot, [lt, gt) == pivot, [gt, last) > pivot
+    auto lt = first, i = first, gt = last;
+    while (i != gt) {
+      const int v = byte_at(key(*i), depth);
+      if (v < pivot) {
+        std::iter_swap(lt++, i++);
+      } else if (v > pivot) {
+        std::iter_swap(i, --gt);
+      } else {
+        ++i;
+      }
+    }
+    sort_from(first, lt, depth, key);
+    sort_from(gt, last, depth, key);
+    if (pivot < 0) { return; } // the strings of the middle range all ended - they're equal
+    first = lt;
+    last = gt;
+    depth++;
+  }
+  insertion_sort(first, last, depth, key);
+}
+
+} // namespace string_sort_detail
+
+/**
+ * Sorts a range by a string key with multikey quicksort (Bentley and
+ * Sedgewick, 1997) - a quicksort that partitions three ways on a single
+ * byte of the keys at a time, moving on to the next byte only for the
+ * keys that tie. Unlike a comparison sort it never compares the common
+ * prefix of the keys again, which is where a comparison sort of words
+ * spends its time.
+ *
+ * The order is the byte-wise lexical order of std::string_view::compare()
+ * (bytes compared as unsigned char, a prefix before a longer string).
+ * The sort isn't stable.
+ *
+ * @tparam It random access iterator type
+ * @tparam Key type of the key function
+ * @param first start of the range
+ * @param last end of the range
+ * @param key function that obtains the std::string_view key of an element
+ */
+template<std::random_access_iterator It, typename Key>
+void multikey_quicksort(It first, It last, Key key) {
+  string_sort_detail::sort_from(first, last, 0, key);
+}
+
+/**
+ * multikey_quicksort() of a range whose keys all share their first
+ * depth bytes (so that only the bytes from depth on are compared).
+ */
+template<std::random_access_iterator It, typename Key>
+void multikey_quicksort(It first, It last, std::size_t depth, Key key) {
+  string_sort_detail::sort_from(first, last, depth, key);
+}
+
+/**
+ * Partitions a range, in place, into N sub-ranges by a bucket function
+ * of its elements (one pass of an American flag sort) - a counting
+ * pass for the sizes of the buckets, then a pass that swaps each
+ * element into the next free place of its bucket.
+ *
+ * @tparam N number of buckets
+ * @tparam It random access iterator type
+ * @tparam BucketOf type of the bucket function
+ * @param first start of the range
+ * @param last end of the range
+ * @param bucket_of function that obtains the bucket (less than N) of an element
+ * @return offsets of the sub-ranges - [bounds[b], bounds[b + 1]) are the
+ * elements of bucket b
+ */
+template<std::size_t N, std::random_access_iterator It, typename BucketOf>
+std::array<std::ptrdiff_t, N + 1> partition_into(It first, It last, BucketOf bucket_of) {
+  std::array<std::ptrdiff_t, N + 1> bounds{};
+  std::for_each(first, last, [&](const auto &elem) { bounds[bucket_of(elem) + 1]++; });
+  for(std::size_t b = 1; b < bounds.size(); b++) { bounds[b] += bounds[b - 1]; }
+  auto next = bounds;
+  for(std::size_t b = 0; b < N; b++) {
+    // swap each element that doesn't belong in bucket b into the next free place of its own bucket
+    while (next[b] < bounds[b + 1]) {
+      const auto k = static_cast<std::size_t>(bucket_of(first[next[b]]));
+      if (k == b) {
+        next[b]++;
+      } else {
+        std::iter_swap(first + next[b], first + next[k]++);
+      }
+    }
+  }
+  return bounds;
+}
+
+#endif //STRING_SORT_H
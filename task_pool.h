@@ -0,0 +1,43 @@
+/* task_pool.h
+
+Copyright 2023 Roger D. Voss
+
+Created by github user roger-dv on 04/08/2023.
+
+Licensed under the MIT License - refer to LICENSE project document.
+
+*/
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <vector>
+
+/**
+ * Runs independent tasks across a pool of threads (the calling thread
+ * being one of them) - each thread takes the next task not yet taken
+ * until none are left. Tasks are taken in the order given, so listing
+ * the largest tasks first balances the load best. Needs only the C++
+ * standard thread support (no TBB, as the std::execution policies of
+ * libstdc++ require).
+ *
+ * @param tasks the tasks to run
+ * @param n_threads number of threads to run them on
+ */
+inline void run_tasks(const std::vector<std::function<void()>> &tasks, unsigned int n_threads) {
+  n_threads = static_cast<unsigned int>(std::clamp<std::size_t>(tasks.size(), 1, n_threads));
+  std::atomic<std::size_t> next_task{0};
+  auto const worker = [&tasks, &next_task] {
+    for(auto i = next_task++; i < tasks.size(); i = next_task++) { tasks[i](); }
+  };
+  std::vector<std::jthread> threads{};
+  threads.reserve(n_threads - 1);
+  for(unsigned int i = 1; i < n_threads; i++) { threads.emplace_back(worker); }
+  worker();
+} // threads are joined here
+
+#endif //TASK_POOL_H
@@ -0,0 +1,309 @@
+/* tokenizer.h
+
+Copyright 2023 Roger D. Voss
+
+Created by github user roger-dv on 04/08/2023.
+
+Licensed under the MIT License - refer to LICENSE project document.
+
+*/
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <string_view>
+#include <vector>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+#include "input_source.h"
+
+/**
+ * Bit masks that classify the characters of a 64 byte block of
+ * input text - bit i of a mask corresponds to byte i of the block.
+ */
+struct char_class_masks {
+  std::uint64_t space = 0;      // whitespace per the "C" locale
+  std::uint64_t alpha = 0;      // A-Z and a-z
+  std::uint64_t hyphen = 0;     // '-'
+  std::uint64_t underscore = 0; // '_'
+  std::uint64_t pound = 0;      // '#'
+};
+
+/**
+ * Signature of a block classifier: classifies the 64 bytes at in
+ * and writes a lowercase copy of them to out in the same pass.
+ */
+using classify_block_fn = void (*)(const char *in, char *out, char_class_masks &masks);
+
+inline void classify_block_scalar(const char *in, char *out, char_class_masks &masks) {
+  masks = {};
+  for(unsigned i = 0; i < 64; i++) {
+    const auto c = in[i];
+    const auto bit = std::uint64_t{1} << i;
+    const bool upper = c >= 'A' && c <= 'Z';
+    if (is_space_char(c)) { masks.space |= bit; }
+    if (upper || (c >= 'a' && c <= 'z')) { masks.alpha |= bit; }
+    if (c == '-') { masks.hyphen |= bit; }
+    if (c == '_') { masks.underscore |= bit; }
+    if (c == '#') { masks.pound |= bit; }
+    out[i] = upper ? static_cast<char>(c | 0x20) : c;
+  }
+}
+
+#if defined(__x86_64__)
+// 16 bytes at a time - SSE2 is all that is needed and is part of the x86-64 baseline
+inline void classify_block_sse2(const char *in, char *out, char_class_masks &masks) {
+  masks = {};
+  for(unsigned i = 0; i < 64; i += 16) {
+    const auto c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    const auto lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+    const auto alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                     _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), lower));
+    const auto upper = _mm_andnot_si128(_mm_cmpeq_epi8(c, lower), alpha);
+    const auto space = _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8(' ')),
+                                    _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('\t' - 1)),
+                                                  _mm_cmpgt_epi8(_mm_set1_epi8('\r' + 1), c)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_or_si128(c, _mm_and_si128(upper, _mm_set1_epi8(0x20))));
+    auto const bits = [i](__m128i m) {
+      return static_cast<std::uint64_t>(static_cast<std::uint16_t>(_mm_movemask_epi8(m))) << i;
+    };
+    masks.space |= bits(space);
+    masks.alpha |= bits(alpha);
+    masks.hyphen |= bits(_mm_cmpeq_epi8(c, _mm_set1_epi8('-')));
+    masks.underscore |= bits(_mm_cmpeq_epi8(c, _mm_set1_epi8('_')));
+    masks.pound |= bits(_mm_cmpeq_epi8(c, _mm_set1_epi8('#')));
+  }
+}
+
+__attribute__((target("avx2")))
+inline std::uint64_t movemask_bits_avx2(__m256i m, unsigned shift) {
+  return static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(m))) << shift;
+}
+
+// 32 bytes at a time - selected at runtime when the processor supports AVX2
+__attribute__((target("avx2")))
+inline void classify_block_avx2(const char *in, char *out, char_class_masks &masks) {
+  masks = {};
+  for(unsigned i = 0; i < 64; i += 32) {
+    const auto c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+    const auto lower = _mm256_or_si256(c, _mm256_set1_epi8(0x20));
+    const auto alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+                                        _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+    const auto upper = _mm256_andnot_si256(_mm256_cmpeq_epi8(c, lower), alpha);
+    const auto space = _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8(' ')),
+                                       _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('\t' - 1)),
+                                                        _mm256_cmpgt_epi8(_mm256_set1_epi8('\r' + 1), c)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                        _mm256_or_si256(c, _mm256_and_si256(upper, _mm256_set1_epi8(0x20))));
+    masks.space |= movemask_bits_avx2(space, i);
+    masks.alpha |= movemask_bits_avx2(alpha, i);
+    masks.hyphen |= movemask_bits_avx2(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('-')), i);
+    masks.underscore |= movemask_bits_avx2(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('_')), i);
+    masks.pound |= movemask_bits_avx2(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('#')), i);
+  }
+}
+#endif
+
+/**
+ * Picks the widest block classifier that the processor supports.
+ *
+ * @return block classifier function
+ */
+inline classify_block_fn select_classify_block() noexcept {
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) { return classify_block_avx2; }
+  return classify_block_sse2;
+#else
+  return classify_block_scalar;
+#endif
+}
+
+/**
+ * Running tally of the tokens that a word_splitter has seen and of
+ * how many of those were accepted as words.
+ */
+struct token_tally {
+  std::uint64_t tokens = 0;
+  std::uint64_t words = 0;
+
+  token_tally& operator+=(const token_tally &other) noexcept {
+    tokens += other.tokens;
+    words += other.words;
+    return *this;
+  }
+};
+
+/**
+ * Adds up the tallies of several threads.
+ *
+ * @param into the tally to add to (nothing is done when nullptr)
+ * @param tallies the tallies of the threads
+ */
+inline void add_tallies(token_tally *into, const std::vector<token_tally> &tallies) noexcept {
+  if (into == nullptr) { return; }
+  std::ranges::for_each(tallies, [into](const token_tally &t) { *into += t; });
+}
+
+/**
+ * Splits a chunk of text into whitespace separated tokens, keeps
+ * only the tokens that are alpha text words or C preprocessor
+ * directives, and makes them lowercase - all in one pass over the
+ * bytes of the chunk, 64 bytes at a time.
+ *
+ * A word begins with an alpha character, '_' or '#'. A word that
+ * begins with '#' must be all alpha characters after that; other
+ * words are also permitted to have embedded hyphen '-' and
+ * underscore '_' characters. (Alpha is A-Z and a-z, which is what
+ * std::isalpha() accepts in the "C" locale.)
+ */
+class word_splitter {
+private:
+  classify_block_fn classify = select_classify_block();
+  std::unique_ptr<char[]> lowered{};
+  std::size_t lowered_capacity = 0;
+  token_tally counted{};
+
+public:
+  /**
+   * Tokenizes a chunk of text, replacing the current words with
+   * the words found in the chunk.
+   *
+   * @param chunk text to tokenize (must end on a token boundary)
+   * @param words receives the lowercase words of the chunk - they
+   * refer into a buffer owned by the word_splitter and remain valid
+   * until the next call of split()
+   */
+  void split(const std::string_view chunk, std::vector<std::string_view> &words) {
+    words.clear();
+    if (lowered_capacity < chunk.size()) {
+      lowered_capacity = std::max(chunk.size(), lowered_capacity * 2);
+      lowered = std::make_unique<char[]>(lowered_capacity);
+    }
+    const auto lc = lowered.get();
+    bool in_word = false, pound_word = false, rejected = false;
+    std::size_t start = 0;
+    for(std::size_t base = 0; base < chunk.size(); base += 64) {
+      char_class_masks m;
+      if (const auto n = chunk.size() - base; n >= 64) {
+        classify(chunk.data() + base, lc + base, m);
+      } else {
+        // final partial block is padded out with whitespace
+        char in[64], out[64];
+        std::memset(in, ' ', sizeof in);
+        std::memcpy(in, chunk.data() + base, n);
+        classify(in, out, m);
+        std::memcpy(lc + base, out, n);
+      }
+      const auto other = ~(m.space | m.alpha | m.hyphen | m.underscore | m.pound);
+      unsigned pos = 0;
+      while (pos < 64) {
+        if (!in_word) {
+          const auto non_space = ~m.space & (~std::uint64_t{0} << pos);
+          if (non_space == 0) { break; }
+          const auto s = static_cast<unsigned>(std::countr_zero(non_space));
+          in_word = true;
+          start = base + s;
+          counted.tokens++;
+          pound_word = ((m.pound >> s) & 1) != 0;
+          rejected = (((other | m.hyphen) >> s) & 1) != 0;
+          if ((pos = s + 1) == 64) { break; }
+        }
+        // characters after the first one, up to the end of the word or of the block
+        const auto from = ~std::uint64_t{0} << pos;
+        const auto space = m.space & from;
+        const auto e = space != 0 ? static_cast<unsigned>(std::countr_zero(space)) : 64u;
+        const auto span = e == 64 ? from : from & ((std::uint64_t{1} << e) - 1);
+        const auto reject = other | m.pound | (pound_word ? m.hyphen | m.underscore : 0);
+        rejected = rejected || (reject & span) != 0;
+        if (e == 64) { break; }
+        if (!rejected) { words.emplace_back(lc + start, base + e - start); }
+        in_word = false;
+        pos = e + 1;
+      }
+    }
+    if (in_word && !rejected) { words.emplace_back(lc + start, chunk.size() - start); }
+    counted.words += words.size();
+  }
+
+  /** @return tally of the tokens split so far */
+  [[nodiscard]] const token_tally& tally() const noexcept { return counted; }
+};
+
+/**
+ * A range view of the words of an input_source - the words being
+ * lowercase alpha text words and C preprocessor directives as
+ * produced by word_splitter. It plays the same role as
+ * std::ranges::istream_view (is a single pass, input range) but a
+ * word is a std::string_view into a buffer holding the lowercase
+ * copy of the current input chunk, instead of a heap allocated
+ * std::string extracted through the iostream machinery.
+ *
+ * A word remains valid only until the iterator is advanced past
+ * the last word of the chunk that it refers to.
+ */
+class word_view : public std::ranges::view_interface<word_view> {
+private:
+  input_source *source = nullptr;
+  word_splitter splitter{};
+  std::vector<std::string_view> words{}; // words of the current chunk
+  std::size_t next_word = 0;
+  std::string_view word{};
+
+  bool next() {
+    while (next_word == words.size()) {
+      auto chunk = source->next_chunk();
+      if (!chunk) { return false; }
+      splitter.split(*chunk, words);
+      next_word = 0;
+    }
+    word = words[next_word++];
+    return true;
+  }
+
+public:
+  class iterator {
+  private: word_view *parent = nullptr;
+  public:
+    using iterator_concept = std::input_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = std::string_view;
+    iterator() = default;
+    explicit iterator(word_view &view) : parent(&view) {}
+    iterator(const iterator&) = delete;
+    iterator(iterator&&) = default;
+    iterator&operator =(const iterator&) = delete;
+    iterator&operator =(iterator&&) = default;
+
+    iterator& operator++() {
+      if (!parent->next()) { parent = nullptr; }
+      return *this;
+    }
+    void operator++(int) { ++*this; }
+    std::string_view operator*() const noexcept { return parent->word; }
+    friend bool operator==(const iterator &x, std::default_sentinel_t) noexcept { return x.parent == nullptr; }
+  };
+
+  word_view() = default;
+  explicit word_view(input_source &src) : source(&src) {}
+
+  iterator begin() {
+    iterator it{*this};
+    ++it;
+    return it;
+  }
+
+  [[nodiscard]] std::default_sentinel_t end() const noexcept { return std::default_sentinel; }
+
+  /** @return tally of the tokens of the input seen so far */
+  [[nodiscard]] const token_tally& tally() const noexcept { return splitter.tally(); }
+};
+
+#endif //TOKENIZER_H